@@ -0,0 +1,303 @@
+/*
+* This file is part of SudokuEz
+*
+* Copyright (C) 2012-2017 Zhong Xu
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*/
+
+//#define SUDOKU_DEBUG
+
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <dirent.h>
+#include <glob.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include "sudokuez.h"
+#include "parallel.h"
+#include "batch.h"
+#include "modes.h"
+#include "profiler.h"
+
+using namespace std;
+using namespace cv;
+
+
+bool is_image_file(string filename)
+{
+    size_t dot = filename.rfind('.');
+    if (dot == string::npos)
+        return false;
+    string ext = filename.substr(dot + 1);
+    transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return ext == "png" || ext == "jpg" || ext == "jpeg" || ext == "bmp"
+        || ext == "tif" || ext == "tiff" || ext == "pgm" || ext == "ppm";
+}
+
+//expand a directory, a glob pattern or a list file (.txt or .lst, one path per line) to image files.
+void list_inputs(string spec, vector<string>& filenames)
+{
+    filenames.clear();
+
+    struct stat st;
+    if (stat(spec.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+    {
+        if (spec[spec.length() - 1] != '/')
+            spec = spec + "/";
+        DIR *pdir = opendir(spec.c_str());
+        struct dirent* ent = NULL;
+        while (pdir != NULL && NULL != (ent = readdir(pdir)))
+        {
+            if (is_image_file(ent->d_name))
+                filenames.push_back(spec + ent->d_name);
+        }
+        if (pdir != NULL)
+            closedir(pdir);
+        sort(filenames.begin(), filenames.end());
+    }
+    else if (spec.find_first_of("*?[") != string::npos)
+    {
+        glob_t g;
+        if (glob(spec.c_str(), 0, NULL, &g) == 0)
+        {
+            for (size_t i = 0; i < g.gl_pathc; i++)
+                filenames.push_back(g.gl_pathv[i]);
+        }
+        globfree(&g);
+    }
+    else if (spec.length() > 4 &&
+             (spec.substr(spec.length() - 4) == ".txt" || spec.substr(spec.length() - 4) == ".lst"))
+    {
+        ifstream fin(spec.c_str());
+        string line;
+        while (getline(fin, line))
+        {
+            if (!line.empty() && line[line.length() - 1] == '\r')
+                line.erase(line.length() - 1);
+            if (!line.empty() && line[0] != '#')
+                filenames.push_back(line);
+        }
+    }
+    else
+    {
+        filenames.push_back(spec);
+    }
+}
+
+string json_escape(string s)
+{
+    stringstream ss;
+    for (size_t i = 0; i < s.length(); i++)
+    {
+        if (s[i] == '"' || s[i] == '\\')
+            ss << '\\' << s[i];
+        else if ((unsigned char)s[i] < 0x20)
+            ss << "\\u" << hex << setw(4) << setfill('0') << (int)s[i] << dec;
+        else
+            ss << s[i];
+    }
+    return ss.str();
+}
+
+string csv_escape(string s)
+{
+    string result = "\"";
+    for (size_t i = 0; i < s.length(); i++)
+    {
+        if (s[i] == '"')
+            result += '"';
+        result += s[i];
+    }
+    return result + "\"";
+}
+
+string grid_string(int grid[])
+{
+    stringstream ss;
+    for (int i = 0; i < 81; i++)
+        ss << grid[i];
+    return ss.str();
+}
+
+struct BatchJob
+{
+    vector<string>* filenames;
+    const SudokuModel* model;
+    string annotated_directory;
+    bool csv;
+    ofstream* fout;
+    pthread_mutex_t mutex;
+    int solved;
+    int annotate_failures;
+};
+
+string record_json(BatchRecord& r)
+{
+    stringstream ss;
+    ss << fixed << setprecision(3);
+    ss << "{\"file\": \"" << json_escape(r.filename) << "\", \"status\": \"" << r.status << "\"";
+    if (!r.grids.empty())
+    {
+        ss << ", \"grids\": [";
+        for (size_t i = 0; i < r.grids.size(); i++)
+        {
+            Grid& grid = r.grids[i];
+            ss << (i > 0 ? ", " : "") << "{\"corners\": [";
+            for (int k = 0; k < 4; k++)
+                ss << (k > 0 ? ", " : "") << "[" << grid.corners[k].x << ", " << grid.corners[k].y << "]";
+            ss << "]"
+               << ", \"status\": \"" << (grid.succeed ? "solved" : "unsolvable") << "\""
+               << ", \"grid\": \"" << grid_string(grid.data) << "\"";
+            if (grid.succeed)
+                ss << ", \"solution\": \"" << grid_string(grid.result) << "\"";
+            ss << "}";
+        }
+        ss << "]";
+    }
+    if (!r.annotated.empty())
+        ss << ", \"annotated\": \"" << json_escape(r.annotated) << "\""
+           << ", \"annotated_written\": " << (r.annotate_failed ? "false" : "true");
+    ss << ", \"timings_ms\": {\"decode\": " << r.decode_ms
+       << ", \"detect\": " << r.detect_ms
+       << ", \"recognize\": " << r.recognize_ms
+       << ", \"solve\": " << r.solve_ms
+       << ", \"total\": " << r.total_ms << "}}";
+    return ss.str();
+}
+
+//one line per grid, or a single line without grid.
+string record_csv(BatchRecord& r)
+{
+    stringstream timings;
+    timings << fixed << setprecision(3)
+            << r.decode_ms << "," << r.detect_ms << "," << r.recognize_ms << ","
+            << r.solve_ms << "," << r.total_ms << ","
+            << csv_escape(r.annotate_failed ? "" : r.annotated);
+    if (r.grids.empty())
+        return csv_escape(r.filename) + ",,," + r.status + ",,," + timings.str();
+
+    stringstream ss;
+    for (size_t i = 0; i < r.grids.size(); i++)
+    {
+        Grid& grid = r.grids[i];
+        ss << (i > 0 ? "\n" : "") << csv_escape(r.filename) << "," << i << ",";
+        for (int k = 0; k < 4; k++)
+            ss << (k > 0 ? " " : "") << grid.corners[k].x << " " << grid.corners[k].y;
+        ss << ","
+           << (grid.succeed ? "solved" : "unsolvable") << ","
+           << grid_string(grid.data) << ","
+           << (grid.succeed ? grid_string(grid.result) : "") << ","
+           << timings.str();
+    }
+    return ss.str();
+}
+
+void batch_task(int i, void* arg)
+{
+    BatchJob* job = (BatchJob*)arg;
+    BatchRecord r;
+    r.filename = (*job->filenames)[i];
+
+    int64 t0 = getTickCount();
+    Mat src_img = imread(r.filename);
+    int64 t1 = getTickCount();
+    Profiler::add(STAGE_DECODE, t0, t1);
+    r.decode_ms = elapsed_ms(t0, t1);
+
+    Mat annotated;
+    bool annotate = !job->annotated_directory.empty();
+    job->model->recognize(src_img, r, annotate ? &annotated : NULL, 1);
+    r.total_ms = elapsed_ms(t0, getTickCount());
+
+    //the input index keeps apart the images of the same name in different
+    //directories or with different extensions
+    if (annotate && !annotated.empty())
+    {
+        string name = r.filename.substr(r.filename.rfind('/') + 1);
+        stringstream ss;
+        ss << job->annotated_directory << setw(6) << setfill('0') << i << "_"
+           << name.substr(0, name.rfind('.')) << ".png";
+        r.annotated = ss.str();
+        r.annotate_failed = !imwrite(r.annotated, annotated);
+    }
+
+    string line = job->csv ? record_csv(r) : record_json(r);
+    pthread_mutex_lock(&job->mutex);
+    *job->fout << line << endl;
+    if (r.status == "solved")
+        job->solved += 1;
+    if (r.annotate_failed)
+        job->annotate_failures += 1;
+    pthread_mutex_unlock(&job->mutex);
+}
+
+//recognize and solve many images without any window, one record per image.
+void recognition_by_batch(const SudokuModel& model, string spec, string output_filename,
+                          string annotated_directory, int threads)
+{
+    vector<string> filenames;
+    list_inputs(spec, filenames);
+    if (filenames.empty())
+    {
+        cout << "No images found in " << spec << "." << endl;
+        return;
+    }
+
+    ofstream fout(output_filename.c_str());
+    if (!fout)
+    {
+        cout << "Can not write " << output_filename << "." << endl;
+        return;
+    }
+
+    BatchJob job;
+    job.filenames = &filenames;
+    job.model = &model;
+    job.annotated_directory = annotated_directory;
+    if (!annotated_directory.empty() && annotated_directory[annotated_directory.length() - 1] != '/')
+        job.annotated_directory = annotated_directory + "/";
+    if (!annotated_directory.empty())
+        mkdir(annotated_directory.c_str(), 0755);
+    job.csv = output_filename.length() > 4 && output_filename.substr(output_filename.length() - 4) == ".csv";
+    job.fout = &fout;
+    job.solved = 0;
+    job.annotate_failures = 0;
+    pthread_mutex_init(&job.mutex, NULL);
+
+    if (job.csv)
+        fout << "file,index,corners,status,grid,solution,decode_ms,detect_ms,recognize_ms,solve_ms,total_ms,annotated" << endl;
+
+    int64 start = getTickCount();
+    run_parallel((int)filenames.size(), threads, batch_task, &job);
+    double seconds = (double)(getTickCount() - start) / getTickFrequency();
+
+    pthread_mutex_destroy(&job.mutex);
+    cout << job.solved << " of " << filenames.size() << " images solved in "
+         << seconds << "s, records are in " << output_filename << endl;
+    if (job.annotate_failures > 0)
+        cerr << "Can not write " << job.annotate_failures << " annotated images in "
+             << annotated_directory << "." << endl;
+}
@@ -0,0 +1,56 @@
+/*
+* This file is part of SudokuEz
+*
+* Copyright (C) 2012-2017 Zhong Xu
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*/
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <string>
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include "sudokuez.h"
+
+using namespace std;
+using namespace cv;
+
+//the recognition of one image file, with the time spent decoding it.
+struct BatchRecord : Recognition
+{
+    string filename;
+    double decode_ms, total_ms;
+    //the annotated image written for it, empty when none was asked for
+    string annotated;
+    bool annotate_failed;
+
+    BatchRecord() : annotate_failed(false) {}
+};
+
+bool is_image_file(string filename);
+void list_inputs(string spec, vector<string>& filenames);
+
+string record_json(BatchRecord& r);
+string record_csv(BatchRecord& r);
+string json_escape(string s);
+
+#endif
@@ -0,0 +1,214 @@
+/*
+* This file is part of SudokuEz
+*
+* Copyright (C) 2012-2017 Zhong Xu
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*/
+
+//#define SUDOKU_DEBUG
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <map>
+#include <sys/resource.h>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include "sudokuez.h"
+#include "stats.h"
+
+using namespace std;
+using namespace cv;
+
+const size_t BENCH_SAMPLES = 1 << 20;
+
+
+const char* keys =
+{
+    "{     c|    corpus| bench/corpus.lst| list file of the benchmark images, one path per line}"
+    "{     s|       svm|   train_data/svm| support vector mechine}"
+    "{     w|    warmup|                3| untimed iterations over the corpus}"
+    "{     n|iterations|               50| timed iterations over the corpus}"
+    "{     b|  baseline|bench/baseline.txt| results of a previous build to compare with}"
+    "{     r| tolerance|              0.1| allowed relative slowdown before failing}"
+    "{     u|    update|            false| write the results as the new baseline}"
+};
+
+//peak resident set size in kilobytes
+long max_rss_kb()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+bool read_baseline(string filename, map<string, double>& values)
+{
+    ifstream fin(filename.c_str());
+    if (!fin)
+        return false;
+    string line;
+    while (getline(fin, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+        istringstream ss(line);
+        string name;
+        double value;
+        if (ss >> name >> value)
+            values[name] = value;
+    }
+    return true;
+}
+
+void write_baseline(string filename, map<string, double>& values)
+{
+    ofstream fout(filename.c_str());
+    fout << "# sudoku_bench baseline, regenerate with: ./sudoku_bench -u" << endl;
+    fout << fixed << setprecision(3);
+    for (map<string, double>::iterator iv = values.begin(); iv != values.end(); iv++)
+        fout << iv->first << " " << iv->second << endl;
+}
+
+//a metric regresses when it grows (or for rates, drops) more than tolerance.
+bool check(string name, double value, map<string, double>& baseline, double tolerance, bool higher_is_better)
+{
+    if (baseline.find(name) == baseline.end())
+        return true;
+    double base = baseline[name];
+    bool ok = higher_is_better ? value >= base * (1 - tolerance) : value <= base * (1 + tolerance);
+    cout << "  " << setw(14) << left << name << right << fixed << setprecision(3)
+         << setw(12) << value << "  baseline " << setw(12) << base
+         << (ok ? "  ok" : "  REGRESSION") << endl;
+    return ok;
+}
+
+//time the get_cropped_imgs() -> get_solution() path over a corpus of grid images.
+int main(int argc, const char** argv)
+{
+    CommandLineParser parser(argc, argv, keys);
+    string corpus_filename = parser.get<string>("corpus");
+    string svm_filename = parser.get<string>("svm");
+    int warmup = parser.get<int>("warmup");
+    int iterations = parser.get<int>("iterations");
+    string baseline_filename = parser.get<string>("baseline");
+    double tolerance = parser.get<double>("tolerance");
+    bool update = parser.get<bool>("update");
+
+    SudokuModel model;
+    if (!model.load(svm_filename, ENGINE_CONTOUR))
+    {
+        cout << "Can not load " << svm_filename << "." << endl;
+        return 2;
+    }
+
+    //decode the corpus up front, it is not part of the measured path
+    vector<Mat> imgs;
+    vector<string> names;
+    ifstream fin(corpus_filename.c_str());
+    string line;
+    while (getline(fin, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+        Mat src_img = imread(line);
+        if (src_img.empty())
+        {
+            cout << "Can not read " << line << "." << endl;
+            return 2;
+        }
+        Mat img;
+        resize(src_img, img, Size(src_img.cols * RESIZED_IMG_ROWS / src_img.rows, RESIZED_IMG_ROWS));
+        imgs.push_back(img);
+        names.push_back(line);
+    }
+    if (imgs.empty())
+    {
+        cout << "The corpus " << corpus_filename << " is empty." << endl;
+        return 2;
+    }
+
+    LatencyStats latency(BENCH_SAMPLES);
+    long runs = 0, detected = 0, solved = 0;
+    for (int it = -warmup; it < iterations; it++)
+    {
+        for (size_t i = 0; i < imgs.size(); i++)
+        {
+            int64 t0 = getTickCount();
+            GrayFrame frame;
+            prepare_frame(imgs[i], frame);
+            Mat cropped_imgs[81];
+            Rect rects[81];
+            vector<Box> detected_boxes;
+            int data[81], result[81];
+            bool found = get_cropped_imgs(frame, model.get_engine(), cropped_imgs, rects, detected_boxes);
+            bool succeed = found && get_solution(frame, rects, model.get_svm(), data, result);
+            double ms = (double)(getTickCount() - t0) * 1000. / getTickFrequency();
+
+            if (it < 0)
+                continue;
+            latency.add(ms);
+            runs += 1;
+            if (found) detected += 1;
+            if (succeed) solved += 1;
+        }
+    }
+
+    map<string, double> results;
+    results["p50_ms"] = latency.get_percentile(50);
+    results["p95_ms"] = latency.get_percentile(95);
+    results["p99_ms"] = latency.get_percentile(99);
+    results["max_rss_kb"] = (double)max_rss_kb();
+    results["detect_rate"] = runs > 0 ? (double)detected / (double)runs : 0.0;
+    results["solve_rate"] = runs > 0 ? (double)solved / (double)runs : 0.0;
+
+    cout << imgs.size() << " images, " << warmup << " warm-up and " << iterations
+         << " timed iterations, mean " << fixed << setprecision(3) << latency.get_mean()
+         << " ms, max " << latency.get_max() << " ms" << endl;
+
+    map<string, double> baseline;
+    if (update || !read_baseline(baseline_filename, baseline))
+    {
+        write_baseline(baseline_filename, results);
+        for (map<string, double>::iterator iv = results.begin(); iv != results.end(); iv++)
+            cout << "  " << setw(14) << left << iv->first << right << setw(12) << iv->second << endl;
+        cout << "Baseline written to " << baseline_filename << "." << endl;
+        return 0;
+    }
+
+    bool ok = true;
+    ok = check("p50_ms", results["p50_ms"], baseline, tolerance, false) && ok;
+    ok = check("p95_ms", results["p95_ms"], baseline, tolerance, false) && ok;
+    ok = check("p99_ms", results["p99_ms"], baseline, tolerance, false) && ok;
+    ok = check("max_rss_kb", results["max_rss_kb"], baseline, tolerance, false) && ok;
+    //recognition is deterministic, so any lost grid is a regression
+    ok = check("detect_rate", results["detect_rate"], baseline, 0, true) && ok;
+    ok = check("solve_rate", results["solve_rate"], baseline, 0, true) && ok;
+
+    if (!ok)
+    {
+        cout << "Performance regression against " << baseline_filename << "." << endl;
+        return 1;
+    }
+    return 0;
+}
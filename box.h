@@ -23,6 +23,9 @@
 *
 */
 
+#ifndef BOX_H
+#define BOX_H
+
 #include <vector>
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
@@ -56,3 +59,4 @@ class Box
     double area;
 };
 
+#endif
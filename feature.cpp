@@ -30,24 +30,25 @@
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/features2d/features2d.hpp>
 #include "ml.h"
-
+#include "sudokuez.h"
+
 using namespace std;
-using namespace cv;
+using namespace cv;
 
 const int UNIFIED_LENGTH = 20;
 
-bool extract_feature(Mat img, float feature[], Mat& processed_img)
+bool extract_feature(GrayFrame& frame, Rect cell, float feature[], Mat& processed_img)
 {
-    int sidelength = img.rows;
-    img = img.rowRange((int)(sidelength * .1), (int)(sidelength * .9))
-            .colRange((int)(sidelength * .1), (int)(sidelength * .9));
-
-    Mat gray, bin;
-    cvtColor(img, gray, CV_BGR2GRAY);
-    int block_size = (int)(MIN(img.cols,img.rows) * 1.0)|1;
+    int sidelength = cell.height;
+    int inner_begin = (int)(sidelength * .1), inner_end = (int)(sidelength * .9);
+    Rect inner(cell.x + inner_begin, cell.y + inner_begin,
+               inner_end - inner_begin, inner_end - inner_begin);
+    if ((inner & Rect(0, 0, frame.gray.cols, frame.gray.rows)) != inner)
+        return false;
 
-    adaptiveThreshold( gray, bin, 255,
-        CV_ADAPTIVE_THRESH_MEAN_C, CV_THRESH_BINARY_INV, block_size, 3 );
+    Mat bin;
+    int block_size = (int)(MIN(inner.width, inner.height) * 1.0)|1;
+    binarize(frame, inner, block_size, 3, bin);
 
     Mat erode_bin;
     erode(bin, erode_bin, Mat());
@@ -122,3 +123,10 @@ bool extract_feature(Mat img, float feature[], Mat& processed_img)
     return true;
 }
 
+//cell images that are not part of a frame, such as training samples.
+bool extract_feature(Mat img, float feature[], Mat& processed_img)
+{
+    GrayFrame frame;
+    prepare_frame(img, frame);
+    return extract_feature(frame, Rect(0, 0, img.cols, img.rows), feature, processed_img);
+}
@@ -0,0 +1,104 @@
+/*
+* This file is part of SudokuEz
+*
+* Copyright (C) 2012-2017 Zhong Xu
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*/
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include "frame.h"
+#include "profiler.h"
+
+using namespace std;
+using namespace cv;
+
+
+void prepare_frame(Mat img, GrayFrame& frame)
+{
+    StageTimer timer(STAGE_GRAYSCALE);
+    if (img.channels() == 1)
+        frame.gray = img;
+    else
+        cvtColor(img, frame.gray, CV_BGR2GRAY);
+    //the sums of a larger frame would overflow
+    CV_Assert(frame.gray.total() <= MAX_FRAME_PIXELS);
+    integral(frame.gray, frame.sum, CV_32S);
+}
+
+//sum of the pixels of [x0, x1) x [y0, y1)
+inline int64 box_sum(Mat& sum, int x0, int y0, int x1, int y1)
+{
+    return (int64)sum.at<int>(y1, x1) - sum.at<int>(y0, x1) - sum.at<int>(y1, x0) + sum.at<int>(y0, x0);
+}
+
+//the sum of every window takes four lookups in the integral image, so the
+//cost does not depend on block_size. the part of a window outside region is
+//made of copies of the border rows and columns of region, which adds their
+//sums (and the corner pixels) times the number of copies.
+void binarize(GrayFrame& frame, Rect region, int block_size, double c, Mat& bin)
+{
+    int h = block_size / 2;
+    int delta = cvFloor(c);
+    //every window holds block_size^2 pixels, as in boxFilter()
+    double scale = 1. / ((double)block_size * block_size);
+    int left = region.x, top = region.y;
+    int right = region.x + region.width - 1, bottom = region.y + region.height - 1;
+    Mat& sum = frame.sum;
+    Mat& gray = frame.gray;
+
+    bin.create(region.height, region.width, CV_8UC1);
+    for (int y = 0; y < region.height; y++)
+    {
+        int above = MAX(h - y, 0), below = MAX(y + h - (region.height - 1), 0);
+        int y0 = MAX(y - h, 0) + top;
+        int y1 = MIN(y + h + 1, region.height) + top;
+        const uchar* src = gray.ptr<uchar>(top + y) + left;
+        uchar* dst = bin.ptr<uchar>(y);
+        for (int x = 0; x < region.width; x++)
+        {
+            int before = MAX(h - x, 0), after = MAX(x + h - (region.width - 1), 0);
+            int x0 = MAX(x - h, 0) + left;
+            int x1 = MIN(x + h + 1, region.width) + left;
+            int64 s = box_sum(sum, x0, y0, x1, y1);
+            if (before > 0)
+                s += before * box_sum(sum, left, y0, left + 1, y1);
+            if (after > 0)
+                s += after * box_sum(sum, right, y0, right + 1, y1);
+            if (above > 0)
+            {
+                s += above * box_sum(sum, x0, top, x1, top + 1);
+                s += (int64)above * before * gray.at<uchar>(top, left);
+                s += (int64)above * after * gray.at<uchar>(top, right);
+            }
+            if (below > 0)
+            {
+                s += below * box_sum(sum, x0, bottom, x1, bottom + 1);
+                s += (int64)below * before * gray.at<uchar>(bottom, left);
+                s += (int64)below * after * gray.at<uchar>(bottom, right);
+            }
+            //the mean is rounded to a pixel value, like the uchar mean of
+            //adaptiveThreshold()
+            int mean = cvRound((double)s * scale);
+            dst[x] = src[x] - mean <= -delta ? 255 : 0;
+        }
+    }
+}
@@ -0,0 +1,56 @@
+/*
+* This file is part of SudokuEz
+*
+* Copyright (C) 2012-2017 Zhong Xu
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*/
+
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <opencv2/core/core.hpp>
+
+
+using namespace std;
+using namespace cv;
+
+//the grayscale of a frame and its integral image. they are computed once
+//per frame by prepare_frame() and shared by the detection of the grid and
+//the binarization of every cell.
+struct GrayFrame
+{
+    Mat gray;
+    //(rows + 1) x (cols + 1) CV_32S sums of gray
+    Mat sum;
+};
+
+//largest frame whose CV_32S sums can not overflow. larger images are
+//resized before.
+const size_t MAX_FRAME_PIXELS = 0x7fffffff / 255;
+
+void prepare_frame(Mat img, GrayFrame& frame);
+
+//adaptive mean threshold of region, the same as adaptiveThreshold() of
+//gray(region) with CV_ADAPTIVE_THRESH_MEAN_C and CV_THRESH_BINARY_INV:
+//windows replicate the border of region.
+void binarize(GrayFrame& frame, Rect region, int block_size, double c, Mat& bin);
+
+#endif
@@ -0,0 +1,161 @@
+/*
+* This file is part of SudokuEz
+*
+* Copyright (C) 2012-2017 Zhong Xu
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*/
+
+//#define SUDOKU_DEBUG
+
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <map>
+#include <algorithm>
+#include <pthread.h>
+#include <opencv2/core/core.hpp>
+#include "parallel.h"
+#include "modes.h"
+#include "solve.h"
+
+using namespace std;
+using namespace cv;
+
+const char* GRADE_NAMES[GRADE_COUNT] = {"invalid", "easy", "medium", "hard", "expert"};
+
+
+//random full grid: the three diagonal boxes do not constrain each other,
+//so they are shuffled freely and the solver completes the rest.
+void random_grid(RNG& rng, int result[])
+{
+    int data[81];
+    for (int n = 0; n < 81; n++)
+        data[n] = 0;
+    for (int b = 0; b < 3; b++)
+    {
+        int digits[9];
+        for (int i = 0; i < 9; i++)
+            digits[i] = i + 1;
+        for (int i = 8; i > 0; i--)
+            swap(digits[i], digits[rng.uniform(0, i + 1)]);
+        for (int k = 0; k < 9; k++)
+            data[(b * 3 + k / 3) * 9 + b * 3 + k % 3] = digits[k];
+    }
+    count_solutions(data, 1, result);
+}
+
+//remove givens in random order as long as the solution stays unique, so
+//the puzzle is minimal.
+void random_puzzle(RNG& rng, int result[], int data[])
+{
+    int order[81];
+    for (int n = 0; n < 81; n++)
+    {
+        data[n] = result[n];
+        order[n] = n;
+    }
+    for (int i = 80; i > 0; i--)
+        swap(order[i], order[rng.uniform(0, i + 1)]);
+    for (int i = 0; i < 81; i++)
+    {
+        int n = order[i];
+        int value = data[n];
+        data[n] = 0;
+        if (count_solutions(data, 2, NULL) != 1)
+            data[n] = value;
+    }
+}
+
+struct GenJob
+{
+    uint64 seed;
+    ofstream* fout;
+    pthread_mutex_t mutex;
+    //lines finished ahead of the next one to write
+    map<int, string> pending;
+    int next;
+    long grades[GRADE_COUNT];
+};
+
+void gen_task(int i, void* arg)
+{
+    GenJob* job = (GenJob*)arg;
+    RNG rng(task_seed(job->seed, i));
+
+    int data[81], result[81];
+    random_grid(rng, result);
+    random_puzzle(rng, result, data);
+    int guesses;
+    int grade = grade_puzzle(data, guesses);
+
+    string line(81 * 2 + 1, ' ');
+    for (int n = 0; n < 81; n++)
+    {
+        line[n] = (char)('0' + data[n]);
+        line[82 + n] = (char)('0' + result[n]);
+    }
+    stringstream ss;
+    ss << line << " " << GRADE_NAMES[grade] << " " << guesses;
+
+    //puzzles are written in order as soon as all the previous ones are done
+    pthread_mutex_lock(&job->mutex);
+    job->pending[i] = ss.str();
+    job->grades[grade] += 1;
+    map<int, string>::iterator it;
+    while ((it = job->pending.find(job->next)) != job->pending.end())
+    {
+        *job->fout << it->second << '\n';
+        job->pending.erase(it);
+        job->next += 1;
+    }
+    pthread_mutex_unlock(&job->mutex);
+}
+
+//generate count uniquely solvable puzzles into output_filename, one
+//"<givens> <solution> <grade> <guesses>" line per puzzle.
+void generate(string output_filename, int count, int seed, int threads)
+{
+    ofstream fout(output_filename.c_str());
+    if (!fout)
+    {
+        cout << "Can not write " << output_filename << "." << endl;
+        return;
+    }
+    fout << "# givens solution grade guesses" << endl;
+
+    GenJob job;
+    job.seed = (uint64)seed;
+    job.fout = &fout;
+    job.next = 0;
+    for (int g = 0; g < GRADE_COUNT; g++)
+        job.grades[g] = 0;
+    pthread_mutex_init(&job.mutex, NULL);
+
+    int64 start = getTickCount();
+    run_parallel(count, threads, gen_task, &job);
+    double seconds = (double)(getTickCount() - start) / getTickFrequency();
+    pthread_mutex_destroy(&job.mutex);
+
+    cout << count << " puzzles generated in " << seconds << "s ("
+         << (double)count / seconds << " puzzles/s) into " << output_filename << endl;
+    for (int g = GRADE_EASY; g < GRADE_COUNT; g++)
+        cout << GRADE_NAMES[g] << ": " << job.grades[g] << endl;
+}
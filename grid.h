@@ -0,0 +1,58 @@
+/*
+* This file is part of SudokuEz
+*
+* Copyright (C) 2012-2017 Zhong Xu
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*/
+
+#ifndef GRID_H
+#define GRID_H
+
+#include <opencv2/core/core.hpp>
+
+
+using namespace std;
+using namespace cv;
+
+//one 9x9 lattice found in a frame, and what was read and solved from it.
+struct Grid
+{
+    //cells in row-major order
+    Rect rects[81];
+    //outer corners of the lattice: top left, top right, bottom right and
+    //bottom left
+    Point corners[4];
+
+    int data[81];
+    int result[81];
+    bool succeed;
+};
+
+//how get_grids() finds grids: from the contours of their cells, or from
+//the two families of lines of the dominant grid, falling back to contours
+//when no lattice of lines is found.
+enum DetectionEngine
+{
+    ENGINE_CONTOUR,
+    ENGINE_HOUGH
+};
+
+#endif
@@ -0,0 +1,239 @@
+/*
+* This file is part of SudokuEz
+*
+* Copyright (C) 2012-2017 Zhong Xu
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*/
+
+//#define SUDOKU_DEBUG
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include "sudokuez.h"
+#include "profiler.h"
+
+using namespace std;
+using namespace cv;
+
+//lines are searched on a frame of this many rows
+const int HOUGH_ROWS = 400;
+const double CANNY_LOW = 50;
+const double CANNY_HIGH = 150;
+//votes a line needs, relative to the shorter side of the small frame
+const double HOUGH_VOTES = .25;
+//lines of a family are within this angle of its first line
+const double FAMILY_ANGLE = CV_PI / 12;
+//lines closer than this are the two edges of one printed line
+const double MERGE_DISTANCE = 4;
+//a line matches a lattice position within this fraction of the spacing
+const double LATTICE_TOLERANCE = .2;
+//lattice positions that must be backed by a line, of the inner 8
+const int MIN_INNER_LINES = 5;
+const double MIN_SPACING = 8;
+
+
+//a line x cos(theta) + y sin(theta) = rho
+struct Line
+{
+    float rho;
+    float theta;
+};
+
+bool by_rho(const Line& a, const Line& b)
+{
+    return a.rho < b.rho;
+}
+
+//angle between a and b, for lines where theta and theta + pi are the same
+double angle_between(double a, double b)
+{
+    double d = fabs(a - b);
+    while (d > CV_PI)
+        d -= CV_PI;
+    return MIN(d, CV_PI - d);
+}
+
+//the lines within FAMILY_ANGLE of reference, turned to the same side as
+//reference so that their rhos can be compared, then sorted and merged.
+void get_family(vector<Vec2f>& lines, double reference, vector<Line>& family)
+{
+    vector<Line> found;
+    for (size_t i = 0; i < lines.size(); i++)
+    {
+        Line l;
+        l.rho = lines[i][0];
+        l.theta = lines[i][1];
+        if (angle_between(l.theta, reference) > FAMILY_ANGLE)
+            continue;
+        if (fabs(l.theta - reference) > CV_PI / 2)
+        {
+            l.theta += (float)(l.theta < reference ? CV_PI : -CV_PI);
+            l.rho = -l.rho;
+        }
+        found.push_back(l);
+    }
+    sort(found.begin(), found.end(), by_rho);
+
+    family.clear();
+    for (size_t i = 0; i < found.size();)
+    {
+        size_t j = i + 1;
+        Line sum = found[i];
+        while (j < found.size() && found[j].rho - found[j - 1].rho < MERGE_DISTANCE)
+        {
+            sum.rho += found[j].rho;
+            sum.theta += found[j].theta;
+            j++;
+        }
+        sum.rho /= (float)(j - i);
+        sum.theta /= (float)(j - i);
+        family.push_back(sum);
+        i = j;
+    }
+}
+
+//the 10 evenly spaced lines best supported by family: every pair of lines
+//is tried as the outer borders, and the inner positions without a line of
+//their own are interpolated, so broken borders are tolerated.
+bool get_lattice_lines(vector<Line>& family, Line lattice[10])
+{
+    int best_matches = -1;
+    double best_span = 0;
+    for (size_t i = 0; i < family.size(); i++)
+    {
+        for (size_t j = i + 1; j < family.size(); j++)
+        {
+            double span = family[j].rho - family[i].rho;
+            double spacing = span / 9;
+            if (spacing < MIN_SPACING)
+                continue;
+
+            Line candidate[10];
+            candidate[0] = family[i];
+            candidate[9] = family[j];
+            int matches = 0;
+            for (int k = 1; k < 9; k++)
+            {
+                double expected = family[i].rho + spacing * k;
+                candidate[k].rho = (float)expected;
+                candidate[k].theta = family[i].theta + (family[j].theta - family[i].theta) * (float)k / 9;
+                for (size_t m = i + 1; m < j; m++)
+                {
+                    if (fabs(family[m].rho - expected) < spacing * LATTICE_TOLERANCE)
+                    {
+                        candidate[k] = family[m];
+                        matches += 1;
+                        break;
+                    }
+                }
+            }
+            if (matches > best_matches || (matches == best_matches && span > best_span))
+            {
+                best_matches = matches;
+                best_span = span;
+                copy(candidate, candidate + 10, lattice);
+            }
+        }
+    }
+    return best_matches >= MIN_INNER_LINES;
+}
+
+Point2f intersect(Line a, Line b)
+{
+    double ca = cos(a.theta), sa = sin(a.theta);
+    double cb = cos(b.theta), sb = sin(b.theta);
+    double det = ca * sb - sa * cb;
+    return Point2f((float)((a.rho * sb - b.rho * sa) / det),
+                   (float)((ca * b.rho - cb * a.rho) / det));
+}
+
+//find the grid from its two families of lines instead of its cells. only
+//the dominant grid of the frame is found. cells are placed like
+//get_grids() does, so either engine can feed recognition.
+bool get_hough_grid(GrayFrame& frame, Grid& grid)
+{
+    StageTimer timer(STAGE_HOUGH);
+    double scale = (double)HOUGH_ROWS / frame.gray.rows;
+    Mat small, edges;
+    resize(frame.gray, small, Size(cvRound(frame.gray.cols * scale), HOUGH_ROWS), 0, 0, INTER_AREA);
+    Canny(small, edges, CANNY_LOW, CANNY_HIGH);
+
+    vector<Vec2f> lines;
+    HoughLines(edges, lines, 1, CV_PI / 180, (int)(MIN(small.rows, small.cols) * HOUGH_VOTES));
+    if (lines.size() < 2)
+        return false;
+
+    //the strongest line gives one family, the other one is perpendicular
+    vector<Line> families[2];
+    get_family(lines, lines[0][1], families[0]);
+    double other = lines[0][1] + (lines[0][1] < CV_PI / 2 ? CV_PI / 2 : -CV_PI / 2);
+    get_family(lines, other, families[1]);
+
+    Line lattice[2][10];
+    if (!get_lattice_lines(families[0], lattice[0]) || !get_lattice_lines(families[1], lattice[1]))
+        return false;
+
+#ifdef SUDOKU_DEBUG
+    cout << lines.size() << " lines, families of " << families[0].size()
+         << " and " << families[1].size() << endl;
+#endif
+
+    //rows come from the family closer to horizontal
+    int row_family = fabs(sin(lattice[0][0].theta)) > fabs(sin(lattice[1][0].theta)) ? 0 : 1;
+    Point2f corners[10][10];
+    for (int y = 0; y < 10; y++)
+        for (int x = 0; x < 10; x++)
+            corners[y][x] = intersect(lattice[row_family][y], lattice[1 - row_family][x]) * (float)(1 / scale);
+    //top left first
+    if (corners[0][0].y > corners[9][0].y)
+        for (int y = 0; y < 5; y++)
+            swap_ranges(corners[y], corners[y] + 10, corners[9 - y]);
+    if (corners[0][0].x > corners[0][9].x)
+        for (int y = 0; y < 10; y++)
+            reverse(corners[y], corners[y] + 10);
+
+    double spacing_x = norm(corners[0][9] - corners[0][0]) / 9, spacing_y = norm(corners[9][0] - corners[0][0]) / 9;
+    if (spacing_x > 2 * spacing_y || spacing_y > 2 * spacing_x)
+        return false;
+    int r = (int)((spacing_x + spacing_y) / 4);
+
+    timer.next(STAGE_CROP);
+    for (int y = 0; y < 9; y++)
+    {
+        for (int x = 0; x < 9; x++)
+        {
+            Point2f c = (corners[y][x] + corners[y][x + 1] + corners[y + 1][x] + corners[y + 1][x + 1]) * .25f;
+            Point fp(cvRound(c.x), cvRound(c.y));
+            if (fp.x - r < 0 || fp.y - r < 0 || fp.x + r > frame.gray.cols || fp.y + r > frame.gray.rows)
+                return false;
+            grid.rects[y * 9 + x] = Rect(fp.x - r, fp.y - r, 2 * r, 2 * r);
+        }
+    }
+    grid.corners[0] = corners[0][0];
+    grid.corners[1] = corners[0][9];
+    grid.corners[2] = corners[9][9];
+    grid.corners[3] = corners[9][0];
+    return true;
+}
@@ -25,37 +25,51 @@
 
 //#define SUDOKU_DEBUG
 
-#include <ctime>
 #include <iostream>
 #include <sstream>
 #include <fstream>
+#include <cstdlib>
 #include <dirent.h>
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/features2d/features2d.hpp>
 #include <ml.h>
-#include "box.h"
+#include "sudokuez.h"
+#include "pipeline.h"
+#include "profiler.h"
+#include "parallel.h"
+#include "batch.h"
+#include "modes.h"
+#include "shard.h"
 
 using namespace std;
 using namespace cv;
 
-const int MAX_SAMPLES = 1000;
-const int FEATURE_SIZE = 80;
-const int RESIZED_IMG_ROWS = 1000;
-
-
-bool get_cropped_imgs(Mat, Mat[], Rect[], vector<Box>&);
-bool extract_feature(Mat, float[], Mat&);
-bool go(int data[], int, int[]);
+//frame time budget of camera mode when -b is not given. replay keeps the
+//rows fixed instead, so that its runs on the same footage can be compared.
+const double CAMERA_BUDGET_MS = 40;
 
 const char* keys =
 {
-    "{     m|      mode|            rec| working mode : rec(recognition), col(collection), tra(train)}"
+    "{     m|      mode|            rec| working mode : rec(recognition), col(collection), lab(labeling), tra(train), batch(batch recognition), serve(recognition server), replay(replay benchmark), synth(synthetic images), gen(puzzle generator)}"
     "{     c|    camera|          false| with camera}"
     "{     f|  filename|       news.jpg| filename}"
+    "{     v|     video|               | video file or image sequence used instead of the camera}"
     "{     s|       svm| train_data/svm| support vector mechine}"
-    "{     p|  pictures|     train_data| picture directory}"
+    "{     p|  pictures|               | picture directory of training (train_data when empty) or synthetic images (synth when empty)}"
+    "{     d|     shard| train_data/cells.shard| packed cell dataset of collection, labeling and training}"
+    "{     o|    output|               | batch records (.csv or .json, results.csv when empty) or generated puzzles (puzzles.txt when empty)}"
+    "{     a|  annotate|               | directory for annotated images in batch mode}"
+    "{     j|   threads|              0| worker threads, 0 for one per cpu}"
+    "{     u|    socket|               | unix socket of the recognition server, stdin/stdout when empty}"
+    "{     n|     count|            100| number of synthetic images or generated puzzles}"
+    "{     r|      seed|              0| random seed of synthetic images and generated puzzles}"
+    "{     b|    budget|               | frame time budget in ms of camera and replay modes, 0 to only follow the grid size (40 in camera mode and fixed -x rows in replay mode when empty)}"
+    "{     l|  min_rows|            480| fewest rows camera frames are processed at}"
+    "{     x|  max_rows|           1000| most rows camera frames are processed at}"
+    "{     e|    engine|        contour| grid detection engine: contour, or hough with contour as fallback}"
+    "{     t|   profile|               | write per-stage timings to a .json, .csv or .trace (chrome://tracing) file}"
 };
 
 void help()
@@ -66,201 +80,199 @@ void help()
     << "2.Recognition with static image file\n"
     << "./sudoku -f news.jpg\n"
     << "3.Collecting images\n"
-    << "./sudoku -m col -f news.jpg -p train_data\n"
-    << "After executing this command, you will see lots of unclassified images in the directory of train_data/unclassified/. You must move these images into corresponding directories in train_data/\n"
-    << "4.Train based on your collected images\n"
-    << "./sudoku -m tra -s train_data/svm\n";
+    << "./sudoku -m col -f 'scans/*.jpg' -d train_data/cells.shard\n"
+    << "After executing this command, the cells of all grids found are appended to the shard train_data/cells.shard. Label them with\n"
+    << "./sudoku -m lab -d train_data/cells.shard\n"
+    << "4.Train based on your collected images (train_data/0-9/ and the labeled cells of the shard)\n"
+    << "./sudoku -m tra -s train_data/svm\n"
+    << "5.Batch recognition of a directory, a glob or a list file\n"
+    << "./sudoku -m batch -f 'scans/*.jpg' -o results.json -a annotated\n"
+    << "6.Recognition server keeping the model loaded\n"
+    << "./sudoku -m serve -u /tmp/sudoku.sock\n"
+    << "7.Replay benchmark of recorded footage\n"
+    << "./sudoku -m replay -v footage.avi\n"
+    << "8.Synthetic puzzle images with ground truth\n"
+    << "./sudoku -m synth -n 1000 -r 1\n"
+    << "9.Graded puzzles with a unique solution\n"
+    << "./sudoku -m gen -o puzzles.txt -n 1000000 -r 1\n"
+    << "Any mode can write the time spent in each step with -t profile.json (or .csv, .trace)\n";
 }
 
-bool get_solution(Mat cropped_imgs[], CvSVM& svm, int data[], int result[])
+void recognition_by_camera(const SudokuModel& model, string video, ResolutionController& resolution)
 {
-    //recognize numbers
-    for (int i = 0; i < 81; i++)
+    FrameSource source;
+    if (!source.open(video))
     {
-        float feature[FEATURE_SIZE];
-        int value = 0;
-        Mat pimg;
-        if (extract_feature(cropped_imgs[i], feature, pimg))
-        {
-            Mat test(1, FEATURE_SIZE, CV_32FC1, Scalar::all(0));
-            for (int j = 0; j < FEATURE_SIZE; j++)
-                test.at<float>(0, j) = feature[j];
-            value = (int)svm.predict(test);
-        }
-        data[i] = value;
+        cout << "Can not open " << (video.empty() ? "camera" : video) << "." << endl;
+        return;
     }
-    //solve sudoku
-    for (int i = 0; i < 81; i++)
-        result[i] = data[i];
-    return go(data, 0, result);
-}
 
-void draw_solution(Mat& img, int data[], int result[], Rect rects[])
-{
-    for (int i = 0; i < 81; i++)
-    {
-        Point p1(rects[i].x, rects[i].y);
-        Point p2(rects[i].x + rects[i].width, rects[i].y + rects[i].height);
-        rectangle(img, p1, p2, Scalar(0, 0, 255), 3);
-    }
-    for (int i = 0; i < 81; i++)
-    {
-        Point p1(rects[i].x, rects[i].y);
-        Point p2(rects[i].x + rects[i].width, rects[i].y + rects[i].height);
-        Point p3(rects[i].x, rects[i].y + rects[i].height);
-        stringstream ss;
-        ss << result[i];
-        Scalar color;
-        if (data[i] == 0)
-            color = Scalar(0, 0, 255);
-        else
-            color = Scalar(255, 0, 0);
-        putText(img, ss.str(), p3, FONT_HERSHEY_SIMPLEX, 2, color, 2);
-    }
+    run_camera_pipeline(source, model, resolution);
 }
 
-void draw_detected_boxes(Mat& img, vector<Box>& detected_boxes)
+void replay(const SudokuModel& model, string video, ResolutionController& resolution)
 {
-    vector<vector<Point> > boxes_contours;
-    for (vector<Box>::iterator ib = detected_boxes.begin(); ib < detected_boxes.end(); ib++)
+    FrameSource source;
+    if (video.empty() || !source.open(video))
     {
-        boxes_contours.push_back(ib->get_contour());
+        cout << "Can not open video " << video << "." << endl;
+        return;
     }
 
-    drawContours(img, boxes_contours, -1, Scalar(0, 255, 0), 3);
+    replay_benchmark(source, model, resolution);
 }
 
-void recognition_by_camera(string svm_filename)
+void recognition_by_filename(const SudokuModel& model, string filename, int threads)
 {
-    //load svm
-    CvSVM svm = CvSVM();
-    svm.load(svm_filename.c_str());
-
-    VideoCapture cap;
-    cap.open(0);
-
-    if( !cap.isOpened() )
-    {
-        cout << "Can not open camera." << endl;
-        return;
-    }
-
-    namedWindow("result", CV_WINDOW_AUTOSIZE);
+    StageTimer timer(STAGE_DECODE);
+    Mat src_img = imread(filename);
+    timer.stop();
 
-    while (true)
+    Recognition r;
+    Mat img;
+    model.recognize(src_img, r, &img, threads);
+    vector<Grid>& grids = r.grids;
+    if (!grids.empty())
     {
-        Mat src_img;
-
-        cap >> src_img;
-        Mat img;
-        resize(src_img, img, Size(src_img.cols * RESIZED_IMG_ROWS / src_img.rows, RESIZED_IMG_ROWS));
-
-
-        Mat cropped_imgs[81];
-        Rect rects[81];
-        vector<Box> detected_boxes;
-        bool succeed = false;
-
-        if (get_cropped_imgs(img, cropped_imgs, rects, detected_boxes))
+        //locations are given in the coordinates of the source image
+        for (size_t g = 0; g < grids.size(); g++)
         {
-            int data[81], result[81];
-            succeed = get_solution(cropped_imgs, svm, data, result);
-
-            if (succeed)
+            cout << "grid " << g + 1 << " at";
+            for (int k = 0; k < 4; k++)
+                cout << " (" << grids[g].corners[k].x << ", " << grids[g].corners[k].y << ")";
+            cout << (grids[g].succeed ? "" : ", unsolvable") << endl;
+            for (int i = 0; i < 81; i++)
             {
-                for (int i = 0; i < 81; i++)
-                {
-                    cout << result[i];
-                    if ((i + 1) % 9 == 0) cout << endl;
-                }
-                cout << endl;
+                cout << grids[g].result[i];
+                if ((i + 1) % 9 == 0) cout << endl;
             }
-
-            draw_solution(img, data, result, rects);
-        }
-        else
-        {
-            draw_detected_boxes(img, detected_boxes);
+            cout << endl;
         }
-        imshow("result", img);
-        char k = (char)waitKey(succeed?15000:30);
-        succeed = false;
-        if( k == 27 ) break;
 
+        imwrite("result.png", img);
+        namedWindow("result", CV_WINDOW_NORMAL);
+        imshow("result", img);
+        waitKey(0);
     }
 }
 
-void recognition_by_filename(string svm_filename, string filename)
+struct CollectionJob
 {
-    //load svm
-    CvSVM svm = CvSVM();
-    svm.load(svm_filename.c_str());
+    vector<string>* filenames;
+    CellShard* shard;
+    DetectionEngine engine;
+    pthread_mutex_t mutex;
+    int grids;
+    int added;
+    int duplicates;
+};
 
-    Mat src_img = imread(filename);
+void collection_task(int i, void* arg)
+{
+    CollectionJob* job = (CollectionJob*)arg;
+    Mat src_img = imread((*job->filenames)[i]);
+    if (src_img.empty() || src_img.cols * RESIZED_IMG_ROWS / src_img.rows == 0)
+        return;
+
+    //cells are cut at the scale recognition reads them
     Mat img;
     resize(src_img, img, Size(src_img.cols * RESIZED_IMG_ROWS / src_img.rows, RESIZED_IMG_ROWS));
-#ifdef SUDOKU_DEBUG
-    cout << "before " << src_img.rows << "," << src_img.cols << endl;
-    cout << "after " << img.rows << "," << img.cols << endl;
-#endif
-
+    GrayFrame frame;
+    prepare_frame(img, frame);
     Mat cropped_imgs[81];
     Rect rects[81];
     vector<Box> detected_boxes;
+    if (!get_cropped_imgs(frame, job->engine, cropped_imgs, rects, detected_boxes))
+        return;
 
-    if (get_cropped_imgs(img, cropped_imgs, rects, detected_boxes))
-    {
-        int data[81], result[81];
-        get_solution(cropped_imgs, svm, data, result);
+    Mat cells[81];
+    for (int j = 0; j < 81; j++)
+        cells[j] = CellShard::normalize(cropped_imgs[j]);
 
-        for (int i = 0; i < 81; i++)
-        {
-            cout << result[i];
-            if ((i + 1) % 9 == 0) cout << endl;
-        }
+    pthread_mutex_lock(&job->mutex);
+    job->grids += 1;
+    for (int j = 0; j < 81; j++)
+    {
+        if (job->shard->append(cells[j]))
+            job->added += 1;
+        else
+            job->duplicates += 1;
+    }
+    pthread_mutex_unlock(&job->mutex);
+}
 
-        draw_solution(img, data, result, rects);
+void collection(string spec, string shard_filename, DetectionEngine engine, int threads)
+{
+    vector<string> filenames;
+    list_inputs(spec, filenames);
 
-        imwrite("result.png", img);
-        namedWindow("result", CV_WINDOW_NORMAL);
-        imshow("result", img);
-        waitKey(0);
+    CellShard shard;
+    if (!shard.open(shard_filename))
+    {
+        cout << "Can not open cell shard " << shard_filename << "." << endl;
+        return;
     }
+
+    CollectionJob job;
+    job.filenames = &filenames;
+    job.shard = &shard;
+    job.engine = engine;
+    job.grids = job.added = job.duplicates = 0;
+    pthread_mutex_init(&job.mutex, NULL);
+    run_parallel((int)filenames.size(), threads, collection_task, &job);
+    pthread_mutex_destroy(&job.mutex);
+
+    cout << job.grids << " grids found in " << filenames.size() << " images, "
+         << job.added << " cells added to " << shard_filename << " ("
+         << job.duplicates << " duplicates skipped, " << shard.get_count() << " in total)." << endl;
+    cout << "Collection completed. You can label the cells with -m lab now." << endl;
 }
 
-void collection(string filename, string pictures_directory)
+//show every unlabeled cell of the shard and store the digit typed for it.
+void labeling(string shard_filename)
 {
-    Mat src_img = imread(filename);
-    Mat cropped_imgs[81];
-    Rect rects[81];
-    vector<Box> detected_boxes;
+    CellShard shard;
+    if (!shard.open(shard_filename))
+    {
+        cout << "Can not open cell shard " << shard_filename << "." << endl;
+        return;
+    }
 
-    if (get_cropped_imgs(src_img, cropped_imgs, rects, detected_boxes))
+    cout << "Type the digit of each cell, 0 for an empty cell, space to skip, Esc to stop." << endl;
+    namedWindow("label", CV_WINDOW_NORMAL);
+    int labeled = 0;
+    for (int i = 0; i < shard.get_count(); i++)
     {
-        time_t t = time(0);
-        for (int y = 0; y < 9; y++)
-        {
-            for (int x = 0; x < 9; x++)
-            {
-                stringstream ss;
-                ss << pictures_directory << "unsorted/" << t << y << x << ".png";
-                cout << "Save "<< ss.str() << endl;
-                imwrite(ss.str(), cropped_imgs[y * 9 + x]);
-            }
-        }
-        cout << "Collection completed. You can classify images manually now." << endl;
+        Mat cell;
+        int label;
+        if (!shard.read(i, cell, label) || label != UNLABELED)
+            continue;
+
+        imshow("label", cell);
+        char k = (char)waitKey(0);
+        if (k == 27)
+            break;
+        if (k >= '0' && k <= '9' && shard.set_label(i, k - '0'))
+            labeled += 1;
     }
+    cout << labeled << " cells labeled." << endl;
 }
 
-void train(string svm_filename, string pictures_directory)
+//append the feature of a cell image as a sample of label.
+void add_sample(Mat img, int label, Mat& src, Mat& dest)
 {
-    Mat src(MAX_SAMPLES, FEATURE_SIZE, CV_32FC1, Scalar::all(0));
-    Mat dest(MAX_SAMPLES, 1, CV_32FC1, Scalar::all(0));
-    int num = 0;
-#ifdef SUDOKU_DEBUG
-    fstream fout;
-    fout.open("debug/characters.csv", fstream::out);
-#endif
+    float feature[FEATURE_SIZE];
+    Mat pimg;
+    if (extract_feature(img, feature, pimg))
+    {
+        src.push_back(Mat(1, FEATURE_SIZE, CV_32FC1, feature));
+        dest.push_back(Mat(1, 1, CV_32FC1, Scalar((float)label)));
+    }
+}
+
+void train(string svm_filename, string pictures_directory, string shard_filename)
+{
+    Mat src, dest;
 
     for (int i = 0; i <= 9; i++)
     {
@@ -269,42 +281,45 @@ void train(string svm_filename, string pictures_directory)
 
         DIR *pdir = opendir(path.str().c_str());
         struct dirent* ent = NULL;
-        while (NULL != (ent = readdir(pdir)))
+        while (pdir != NULL && NULL != (ent = readdir(pdir)))
         {
             if (ent->d_type == 8) // file
             {
                 stringstream filename;
                 filename << path.str() << "/" << ent->d_name;
                 Mat img = imread(filename.str().c_str());
-
-                float feature[FEATURE_SIZE];
-                Mat pimg;
-                if (extract_feature(img, feature, pimg))
-                {
-#ifdef SUDOKU_DEBUG
-                    fout << i << " ";
-#endif
-                    for (int j = 0; j < FEATURE_SIZE; j++)
-                    {
-                        src.at<float>(num, j) = feature[j];
-#ifdef SUDOKU_DEBUG
-                        fout << feature[j] << " ";
-#endif
-                    }
-#ifdef SUDOKU_DEBUG
-                    fout << endl;
-#endif
-                    dest.at<float>(num, 0) = (float)i;
-                    num += 1;
-                }
+                add_sample(img, i, src, dest);
             }
         }
+        if (pdir != NULL)
+            closedir(pdir);
+    }
+
+    //labeled cells of the shard are read in one sequential pass
+    CellShard shard;
+    if (shard.open(shard_filename))
+    {
+        for (int i = 0; i < shard.get_count(); i++)
+        {
+            Mat cell;
+            int label;
+            if (shard.read(i, cell, label) && label != UNLABELED)
+                add_sample(cell, label, src, dest);
+        }
     }
+
 #ifdef SUDOKU_DEBUG
+    fstream fout;
+    fout.open("debug/characters.csv", fstream::out);
+    for (int i = 0; i < src.rows; i++)
+    {
+        fout << dest.at<float>(i, 0) << " ";
+        for (int j = 0; j < FEATURE_SIZE; j++)
+            fout << src.at<float>(i, j) << " ";
+        fout << endl;
+    }
     fout.close();
 #endif
-    src = src.rowRange(0, num);
-    dest = dest.rowRange(0, num);
 
     CvSVM svm = CvSVM();
 	CvSVMParams param;
@@ -320,40 +335,110 @@ void train(string svm_filename, string pictures_directory)
 
 int main( int argc, const char** argv )
 {
-    help();
     CommandLineParser parser(argc, argv, keys);
-    cout << "Paramerers:\n";
-    parser.printParams();
-
     string mode = parser.get<string>("mode");
+    //the server may answer on stdout
+    if (mode != "serve")
+    {
+        help();
+        cout << "Paramerers:\n";
+        parser.printParams();
+    }
+
     bool use_camera = parser.get<bool>("camera");
     string filename = parser.get<string>("filename");
+    string video = parser.get<string>("video");
     string svm_filename = parser.get<string>("svm");
     string pictures_directory = parser.get<string>("pictures");
+    string shard_filename = parser.get<string>("shard");
+    string output_filename = parser.get<string>("output");
+    string annotated_directory = parser.get<string>("annotate");
+    int threads = parser.get<int>("threads");
+    string socket_path = parser.get<string>("socket");
+    int count = parser.get<int>("count");
+    int seed = parser.get<int>("seed");
+    string profile_filename = parser.get<string>("profile");
+    string engine = parser.get<string>("engine");
+    DetectionEngine detection_engine = ENGINE_CONTOUR;
+    if (engine == "hough")
+        detection_engine = ENGINE_HOUGH;
+    else if (engine != "contour")
+        cerr << "Unknown engine " << engine << ", contour is used." << endl;
+    string budget = parser.get<string>("budget");
+    int min_rows = parser.get<int>("min_rows");
+    int max_rows = parser.get<int>("max_rows");
+    double budget_ms = budget.empty() ? CAMERA_BUDGET_MS : atof(budget.c_str());
+    if (mode == "replay" && budget.empty())
+    {
+        min_rows = max_rows;
+        budget_ms = 0;
+    }
+    ResolutionController resolution(min_rows, max_rows, budget_ms);
+    if (!profile_filename.empty())
+        Profiler::enable(profile_filename.substr(profile_filename.rfind('.') + 1) == "trace");
+    if (pictures_directory.empty())
+        pictures_directory = mode == "synth" ? "synth" : "train_data";
     if (pictures_directory[pictures_directory.length() - 1] != '/')
         pictures_directory = pictures_directory + "/";
 
+    //the model is loaded once and shared by every thread of the mode
+    SudokuModel model;
+    bool recognizes = mode == "rec" || mode == "batch" || mode == "serve" || mode == "replay";
+    if (recognizes && !model.load(svm_filename, detection_engine))
+    {
+        cerr << "Can not load the model " << svm_filename << "." << endl;
+        return 1;
+    }
+
     if (mode == "rec")
     {
-        if (use_camera)
-            recognition_by_camera(svm_filename);
+        if (use_camera || !video.empty())
+            recognition_by_camera(model, video, resolution);
         else
-            recognition_by_filename(svm_filename, filename);
+            recognition_by_filename(model, filename, threads);
     }
     else if (mode == "col")
     {
         if (use_camera)
             cout << "Camera can be only used in Recognition mode." << endl;
         else
-            collection(filename, pictures_directory);
+            collection(filename, shard_filename, detection_engine, threads);
+    }
+    else if (mode == "lab")
+    {
+        labeling(shard_filename);
     }
     else if (mode == "tra")
     {
-        train(svm_filename, pictures_directory);
+        train(svm_filename, pictures_directory, shard_filename);
+    }
+    else if (mode == "batch")
+    {
+        recognition_by_batch(model, filename, output_filename.empty() ? "results.csv" : output_filename,
+                             annotated_directory, threads);
+    }
+    else if (mode == "serve")
+    {
+        recognition_server(model, socket_path, threads);
+    }
+    else if (mode == "replay")
+    {
+        replay(model, video, resolution);
+    }
+    else if (mode == "synth")
+    {
+        synthesize(pictures_directory, count, seed, threads);
+    }
+    else if (mode == "gen")
+    {
+        generate(output_filename.empty() ? "puzzles.txt" : output_filename, count, seed, threads);
     }
     else
         cout << "Invalid mode." << endl;
 
+    if (!profile_filename.empty() && !Profiler::write(profile_filename))
+        cerr << "Can not write " << profile_filename << "." << endl;
+
     return 0;
 }
 
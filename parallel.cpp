@@ -0,0 +1,101 @@
+/*
+* This file is part of SudokuEz
+*
+* Copyright (C) 2012-2017 Zhong Xu
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*/
+
+#include <vector>
+#include <pthread.h>
+#include <opencv2/core/core.hpp>
+#include "parallel.h"
+
+using namespace std;
+using namespace cv;
+
+
+struct ParallelContext
+{
+    int n;
+    int next;
+    void (*task)(int, void*);
+    void* arg;
+    pthread_mutex_t mutex;
+};
+
+void* parallel_worker(void* arg)
+{
+    ParallelContext* ctx = (ParallelContext*)arg;
+    while (true)
+    {
+        pthread_mutex_lock(&ctx->mutex);
+        int i = ctx->next;
+        ctx->next += 1;
+        pthread_mutex_unlock(&ctx->mutex);
+        if (i >= ctx->n)
+            break;
+        ctx->task(i, ctx->arg);
+    }
+    return NULL;
+}
+
+//splitmix64 finalizer, a bijection that spreads every input bit
+uint64 mix_bits(uint64 x)
+{
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+uint64 task_seed(uint64 seed, int i)
+{
+    return mix_bits(mix_bits(seed) + (uint64)i);
+}
+
+void run_parallel(int n, int threads, void (*task)(int, void*), void* arg)
+{
+    if (threads <= 0)
+        threads = getNumberOfCPUs();
+    if (threads > n)
+        threads = n;
+
+    if (threads <= 1)
+    {
+        for (int i = 0; i < n; i++)
+            task(i, arg);
+        return;
+    }
+
+    ParallelContext ctx;
+    ctx.n = n;
+    ctx.next = 0;
+    ctx.task = task;
+    ctx.arg = arg;
+    pthread_mutex_init(&ctx.mutex, NULL);
+
+    vector<pthread_t> workers(threads);
+    for (int i = 0; i < threads; i++)
+        pthread_create(&workers[i], NULL, parallel_worker, &ctx);
+    for (int i = 0; i < threads; i++)
+        pthread_join(workers[i], NULL);
+
+    pthread_mutex_destroy(&ctx.mutex);
+}
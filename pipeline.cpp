@@ -0,0 +1,451 @@
+/*
+* This file is part of SudokuEz
+*
+* Copyright (C) 2012-2017 Zhong Xu
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*/
+
+//#define SUDOKU_DEBUG
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <unistd.h>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include "sudokuez.h"
+#include "tracker.h"
+#include "render.h"
+#include "recognizer.h"
+#include "pipeline.h"
+#include "batch.h"
+#include "stats.h"
+#include "profiler.h"
+
+using namespace std;
+using namespace cv;
+
+const size_t STAGE_QUEUE_SIZE = 2;
+const int DISPLAY_DELAY = 10;
+const double STATS_INTERVAL_SECONDS = 5.0;
+const size_t REPLAY_SAMPLES = 1 << 20;
+//cells narrower than this are not read reliably, and wider ones do not
+//read any better
+const double MIN_CELL_SIDE = 32;
+const double MAX_CELL_SIDE = 64;
+const double COST_SMOOTHING = .2;
+//every change of rows costs the tracker a rescale, small ones are ignored
+const double ROWS_HYSTERESIS = .05;
+const int ROWS_STEP = 8;
+
+
+bool FrameSource::open(string name)
+{
+    filenames.clear();
+    next = 0;
+    live = name.empty();
+    if (live)
+        return cap.open(0);
+
+    //printf patterns and video files are read by VideoCapture
+    if (name.find('%') == string::npos)
+    {
+        list_inputs(name, filenames);
+        if (filenames.size() > 1 || (filenames.size() == 1 && is_image_file(filenames[0])))
+            return true;
+        filenames.clear();
+    }
+    return cap.open(name);
+}
+
+bool FrameSource::read(Mat& frame)
+{
+    StageTimer timer(STAGE_DECODE);
+    if (!filenames.empty())
+    {
+        frame = Mat();
+        while (frame.empty() && next < filenames.size())
+            frame = imread(filenames[next++]);
+        return !frame.empty();
+    }
+    return cap.read(frame) && !frame.empty();
+}
+
+double FrameSource::get_fps()
+{
+    return filenames.empty() && !live ? cap.get(CV_CAP_PROP_FPS) : 0.0;
+}
+
+ResolutionController::ResolutionController(int min_rows, int max_rows, double budget_ms)
+{
+    this->min_rows = MAX(min_rows, ROWS_STEP);
+    this->max_rows = MAX(max_rows, this->min_rows);
+    this->budget_ms = budget_ms;
+    rows = this->max_rows;
+    cost = 0;
+    pthread_mutex_init(&mutex, NULL);
+}
+
+ResolutionController::~ResolutionController()
+{
+    pthread_mutex_destroy(&mutex);
+}
+
+int ResolutionController::get_rows()
+{
+    pthread_mutex_lock(&mutex);
+    int result = rows;
+    pthread_mutex_unlock(&mutex);
+    return result;
+}
+
+void ResolutionController::update(int frame_rows, double frame_ms, double cell_side)
+{
+    pthread_mutex_lock(&mutex);
+    double frame_cost = frame_ms / ((double)frame_rows * (double)frame_rows);
+    cost = cost == 0 ? frame_cost : cost + COST_SMOOTHING * (frame_cost - cost);
+
+    double target = max_rows;
+    if (budget_ms > 0 && cost > 0)
+        target = sqrt(budget_ms / cost);
+    if (cell_side > 0)
+    {
+        target = MIN(target, frame_rows * MAX_CELL_SIDE / cell_side);
+        //accuracy comes before the budget
+        target = MAX(target, frame_rows * MIN_CELL_SIDE / cell_side);
+    }
+    target = MIN(MAX(target, (double)min_rows), (double)max_rows);
+
+    if (fabs(target - rows) > rows * ROWS_HYSTERESIS)
+        rows = MAX((int)target / ROWS_STEP * ROWS_STEP, min_rows);
+    pthread_mutex_unlock(&mutex);
+}
+
+void detect_frame(const SudokuModel& model, GridTracker& tracker, CameraFrame& frame, int rows)
+{
+    int64 start = getTickCount();
+    StageTimer timer(STAGE_RESIZE);
+    Mat img;
+    resize(frame.img, img, Size(frame.img.cols * rows / frame.img.rows, rows));
+    frame.img = img;
+    frame.rows = rows;
+    timer.stop();
+    prepare_frame(frame.img, frame.gray);
+    //a grid locked at another resolution is followed at this one
+    if (tracker.is_locked())
+        tracker.rescale(frame.gray.gray.size());
+
+    //follow the locked grid, and only run the full detection when it is lost
+    StageTimer track_timer(STAGE_TRACK);
+    frame.detected_boxes.clear();
+    frame.located = tracker.track(frame.gray.gray, frame.rects);
+    track_timer.stop();
+    Mat cropped_imgs[81];
+    if (!frame.located && get_cropped_imgs(frame.gray, model.get_engine(), cropped_imgs,
+                                            frame.rects, frame.detected_boxes))
+    {
+        tracker.lock(frame.gray.gray, frame.rects);
+        frame.located = true;
+    }
+    frame.generation = tracker.get_generation();
+    frame.detect_ms = (double)(getTickCount() - start) * 1000. / getTickFrequency();
+}
+
+//recognize the located grid and solve it once its digits are stable.
+void recognize_frame(const SudokuModel& model, GridRecognizer& recognizer, CameraFrame& frame)
+{
+    int64 start = getTickCount();
+    frame.succeed = false;
+    frame.classified = 0;
+    if (frame.located)
+    {
+        //the votes belong to the grid that was followed until now
+        recognizer.follow(frame.generation);
+        bool stable = recognizer.recognize(frame.gray, frame.rects, model.get_svm(), frame.data);
+        frame.classified = recognizer.get_classified();
+        if (stable)
+            frame.succeed = recognizer.solve(frame.data, frame.result);
+        else
+            copy(frame.data, frame.data + 81, frame.result);
+    }
+    frame.recognize_ms = (double)(getTickCount() - start) * 1000. / getTickFrequency();
+}
+
+//draw the grid of a located frame with renderer on frame.img, or into
+//output when it is not NULL.
+void render_frame(SolutionRenderer& renderer, CameraFrame& frame, Mat* output)
+{
+    if (!frame.located)
+        return;
+    if (output != NULL)
+        renderer.draw(frame.img, frame.data, frame.result, frame.rects, *output);
+    else
+        renderer.draw(frame.img, frame.data, frame.result, frame.rects);
+}
+
+//the side of the cells of the grid, 0 when there is none.
+double cell_side(CameraFrame& frame)
+{
+    return frame.located ? (double)frame.rects[0].width : 0;
+}
+
+struct CameraPipeline
+{
+    CameraPipeline(FrameSource& source, const SudokuModel& model, ResolutionController& resolution);
+
+    FrameSource& source;
+    const SudokuModel& model;
+    ResolutionController& resolution;
+    GridTracker tracker;
+    GridRecognizer recognizer;
+    SolutionRenderer renderer;
+
+    BoundedQueue<CameraFrame> detect_queue;
+    BoundedQueue<CameraFrame> recognize_queue;
+    BoundedQueue<CameraFrame> display_queue;
+    long displayed;
+    //cells classified in the displayed frames with a grid
+    long classified;
+    long recognized;
+};
+
+CameraPipeline::CameraPipeline(FrameSource& source, const SudokuModel& model, ResolutionController& resolution)
+    : source(source), model(model), resolution(resolution),
+      detect_queue(STAGE_QUEUE_SIZE),
+      recognize_queue(STAGE_QUEUE_SIZE),
+      display_queue(STAGE_QUEUE_SIZE)
+{
+    displayed = 0;
+    classified = 0;
+    recognized = 0;
+}
+
+void* capture_stage(void* arg)
+{
+    CameraPipeline* p = (CameraPipeline*)arg;
+    //video files are played at their own frame rate instead of as fast as they decode
+    double fps = p->source.get_fps();
+    int64 start = getTickCount();
+    long frames = 0;
+    while (!p->detect_queue.is_closed())
+    {
+        CameraFrame frame;
+        if (!p->source.read(frame.img))
+            break;
+        if (fps > 0)
+        {
+            double ahead = (double)frames / fps - (double)(getTickCount() - start) / getTickFrequency();
+            if (ahead > 0)
+                usleep((useconds_t)(ahead * 1e6));
+        }
+        frames += 1;
+        p->detect_queue.push(frame);
+    }
+    p->detect_queue.close();
+    return NULL;
+}
+
+void* detect_stage(void* arg)
+{
+    CameraPipeline* p = (CameraPipeline*)arg;
+    CameraFrame frame;
+    while (p->detect_queue.pop(frame))
+    {
+        detect_frame(p->model, p->tracker, frame, p->resolution.get_rows());
+        p->recognize_queue.push(frame);
+    }
+    p->recognize_queue.close();
+    return NULL;
+}
+
+void* recognize_stage(void* arg)
+{
+    CameraPipeline* p = (CameraPipeline*)arg;
+    CameraFrame frame;
+    while (p->recognize_queue.pop(frame))
+    {
+        recognize_frame(p->model, p->recognizer, frame);
+        //the stages overlap, so the slower one limits the frame rate
+        p->resolution.update(frame.rows, MAX(frame.detect_ms, frame.recognize_ms), cell_side(frame));
+        p->display_queue.push(frame);
+    }
+    p->display_queue.close();
+    return NULL;
+}
+
+template<typename T>
+void print_stage_stats(string name, BoundedQueue<T>& input, long processed, double seconds)
+{
+    cout << name << ": " << fixed << setprecision(1) << (double)processed / seconds << " fps"
+         << ", queue " << input.get_depth()
+         << ", dropped " << input.get_dropped();
+}
+
+void print_pipeline_stats(CameraPipeline& p, double seconds)
+{
+    cout << "capture: " << fixed << setprecision(1) << (double)p.detect_queue.get_pushed() / seconds << " fps | ";
+    print_stage_stats("detect", p.detect_queue, p.recognize_queue.get_pushed(), seconds);
+    cout << " | ";
+    print_stage_stats("recognize", p.recognize_queue, p.display_queue.get_pushed(), seconds);
+    cout << " | ";
+    print_stage_stats("display", p.display_queue, p.displayed, seconds);
+    cout << " | rows " << p.resolution.get_rows();
+    if (p.recognized > 0)
+        cout << ", classified " << (double)p.classified / (double)p.recognized << " cells/frame";
+    cout << endl;
+}
+
+void run_camera_pipeline(FrameSource& source, const SudokuModel& model, ResolutionController& resolution)
+{
+    CameraPipeline p(source, model, resolution);
+
+    pthread_t capture_thread, detect_thread, recognize_thread;
+    pthread_create(&capture_thread, NULL, capture_stage, &p);
+    pthread_create(&detect_thread, NULL, detect_stage, &p);
+    pthread_create(&recognize_thread, NULL, recognize_stage, &p);
+
+    //highgui wants the main thread, so the display stage runs here
+    namedWindow("result", CV_WINDOW_AUTOSIZE);
+    int64 start = getTickCount();
+    int64 last_report = start;
+    bool stopped = false;
+    //the solution printed last, which is only printed again when it changes
+    int printed[81] = {0};
+    //the frames still queued when the source ends are shown too
+    while (!p.display_queue.is_closed() || p.display_queue.get_depth() > 0)
+    {
+        CameraFrame frame;
+        //the overlay follows the tracked grid on every frame, and is drawn
+        //here so that the recognition stage does not wait for it
+        if (p.display_queue.try_pop(frame))
+        {
+            if (frame.succeed && !equal(frame.result, frame.result + 81, printed))
+            {
+                for (int i = 0; i < 81; i++)
+                {
+                    cout << frame.result[i];
+                    if ((i + 1) % 9 == 0) cout << endl;
+                }
+                cout << endl;
+                copy(frame.result, frame.result + 81, printed);
+            }
+            if (frame.located)
+                render_frame(p.renderer, frame, NULL);
+            else
+                draw_detected_boxes(frame.img, frame.detected_boxes);
+            imshow("result", frame.img);
+            p.displayed += 1;
+            if (frame.located)
+            {
+                p.classified += frame.classified;
+                p.recognized += 1;
+            }
+        }
+
+        char k = (char)waitKey(DISPLAY_DELAY);
+        if( k == 27 )
+        {
+            stopped = true;
+            break;
+        }
+
+        int64 now = getTickCount();
+        if ((double)(now - last_report) > STATS_INTERVAL_SECONDS * getTickFrequency())
+        {
+            print_pipeline_stats(p, (double)(now - start) / getTickFrequency());
+            last_report = now;
+        }
+    }
+
+    //the last frame of a finished file stays on screen until a key is pressed
+    if (!stopped && p.displayed > 0)
+        waitKey(0);
+
+    p.detect_queue.close();
+    p.recognize_queue.close();
+    p.display_queue.close();
+    pthread_join(capture_thread, NULL);
+    pthread_join(detect_thread, NULL);
+    pthread_join(recognize_thread, NULL);
+}
+
+//process every frame of a recorded source in order and as fast as possible,
+//so that builds can be compared on identical footage.
+void replay_benchmark(FrameSource& source, const SudokuModel& model, ResolutionController& resolution)
+{
+    GridTracker tracker;
+    GridRecognizer recognizer;
+    SolutionRenderer renderer;
+    Mat view;
+    LatencyStats latency(REPLAY_SAMPLES);
+    long frames = 0, located = 0, solved = 0, classified = 0;
+    double rows = 0;
+
+    int64 start = getTickCount();
+    while (true)
+    {
+        CameraFrame frame;
+        if (!source.read(frame.img))
+            break;
+
+        int64 t0 = getTickCount();
+        detect_frame(model, tracker, frame, resolution.get_rows());
+        recognize_frame(model, recognizer, frame);
+        render_frame(renderer, frame, &view);
+        double ms = (double)(getTickCount() - t0) * 1000. / getTickFrequency();
+        latency.add(ms);
+        resolution.update(frame.rows, ms, cell_side(frame));
+        rows += frame.rows;
+
+        frames += 1;
+        if (frame.located) located += 1;
+        if (frame.succeed) solved += 1;
+        classified += frame.classified;
+    }
+    double seconds = (double)(getTickCount() - start) / getTickFrequency();
+
+    if (frames == 0)
+    {
+        cout << "No frames to replay." << endl;
+        return;
+    }
+    cout << fixed << setprecision(2)
+         << "frames:     " << frames << " in " << seconds << "s, "
+         << (double)frames / seconds << " fps (including decoding)\n"
+         << "latency ms: mean " << latency.get_mean()
+         << ", p50 " << latency.get_percentile(50)
+         << ", p95 " << latency.get_percentile(95)
+         << ", p99 " << latency.get_percentile(99)
+         << ", max " << latency.get_max() << "\n"
+         << "rows:       " << rows / (double)frames << " on average, ";
+    if (resolution.get_min_rows() == resolution.get_max_rows())
+        cout << "fixed at " << resolution.get_max_rows();
+    else if (resolution.get_budget() > 0)
+        cout << resolution.get_min_rows() << " to " << resolution.get_max_rows()
+             << " within " << resolution.get_budget() << "ms";
+    else
+        cout << resolution.get_min_rows() << " to " << resolution.get_max_rows() << " following the grid";
+    cout << "\n"
+         << "lock rate:  " << 100. * (double)located / (double)frames << "%\n"
+         << "solve rate: " << 100. * (double)solved / (double)frames << "%\n"
+         << "classified: " << (located > 0 ? (double)classified / (double)located : 0.) << " cells/located frame" << endl;
+}
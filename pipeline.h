@@ -0,0 +1,300 @@
+/*
+* This file is part of SudokuEz
+*
+* Copyright (C) 2012-2017 Zhong Xu
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*/
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <deque>
+#include <pthread.h>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include "sudokuez.h"
+
+using namespace std;
+using namespace cv;
+
+//queue between two pipeline stages. when push() finds it full the oldest
+//item is dropped, so a slow consumer never holds the producer back and
+//always gets the most recent frames.
+template<typename T>
+class BoundedQueue
+{
+    public:
+
+    BoundedQueue(size_t capacity);
+    ~BoundedQueue();
+
+    void push(const T& item);
+    //wait for room instead of dropping, so a slow consumer holds the
+    //producer back. returns false once the queue is closed.
+    bool wait_push(const T& item);
+    //wait for an item. returns false once the queue is closed and empty.
+    bool pop(T& item);
+    bool try_pop(T& item);
+    //stop the producers. the items already queued can still be popped.
+    void close();
+
+    bool is_closed();
+    size_t get_depth();
+    long get_pushed();
+    long get_dropped();
+
+    private:
+
+    BoundedQueue(const BoundedQueue&);
+    BoundedQueue& operator=(const BoundedQueue&);
+
+    deque<T> items;
+    size_t capacity;
+    bool closed;
+    long pushed;
+    long dropped;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+};
+
+template<typename T>
+BoundedQueue<T>::BoundedQueue(size_t capacity)
+{
+    this->capacity = capacity;
+    closed = false;
+    pushed = 0;
+    dropped = 0;
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&not_empty, NULL);
+    pthread_cond_init(&not_full, NULL);
+}
+
+template<typename T>
+BoundedQueue<T>::~BoundedQueue()
+{
+    pthread_cond_destroy(&not_empty);
+    pthread_cond_destroy(&not_full);
+    pthread_mutex_destroy(&mutex);
+}
+
+template<typename T>
+void BoundedQueue<T>::push(const T& item)
+{
+    pthread_mutex_lock(&mutex);
+    if (!closed)
+    {
+        if (items.size() >= capacity)
+        {
+            items.pop_front();
+            dropped += 1;
+        }
+        items.push_back(item);
+        pushed += 1;
+        pthread_cond_signal(&not_empty);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+template<typename T>
+bool BoundedQueue<T>::wait_push(const T& item)
+{
+    pthread_mutex_lock(&mutex);
+    while (!closed && items.size() >= capacity)
+        pthread_cond_wait(&not_full, &mutex);
+    bool result = !closed;
+    if (result)
+    {
+        items.push_back(item);
+        pushed += 1;
+        pthread_cond_signal(&not_empty);
+    }
+    pthread_mutex_unlock(&mutex);
+    return result;
+}
+
+template<typename T>
+bool BoundedQueue<T>::pop(T& item)
+{
+    pthread_mutex_lock(&mutex);
+    while (!closed && items.empty())
+        pthread_cond_wait(&not_empty, &mutex);
+    bool result = !items.empty();
+    if (result)
+    {
+        item = items.front();
+        items.pop_front();
+        pthread_cond_signal(&not_full);
+    }
+    pthread_mutex_unlock(&mutex);
+    return result;
+}
+
+template<typename T>
+bool BoundedQueue<T>::try_pop(T& item)
+{
+    pthread_mutex_lock(&mutex);
+    bool result = !items.empty();
+    if (result)
+    {
+        item = items.front();
+        items.pop_front();
+        pthread_cond_signal(&not_full);
+    }
+    pthread_mutex_unlock(&mutex);
+    return result;
+}
+
+template<typename T>
+void BoundedQueue<T>::close()
+{
+    pthread_mutex_lock(&mutex);
+    closed = true;
+    pthread_cond_broadcast(&not_empty);
+    pthread_cond_broadcast(&not_full);
+    pthread_mutex_unlock(&mutex);
+}
+
+template<typename T>
+bool BoundedQueue<T>::is_closed()
+{
+    pthread_mutex_lock(&mutex);
+    bool result = closed;
+    pthread_mutex_unlock(&mutex);
+    return result;
+}
+
+template<typename T>
+size_t BoundedQueue<T>::get_depth()
+{
+    pthread_mutex_lock(&mutex);
+    size_t result = items.size();
+    pthread_mutex_unlock(&mutex);
+    return result;
+}
+
+template<typename T>
+long BoundedQueue<T>::get_pushed()
+{
+    pthread_mutex_lock(&mutex);
+    long result = pushed;
+    pthread_mutex_unlock(&mutex);
+    return result;
+}
+
+template<typename T>
+long BoundedQueue<T>::get_dropped()
+{
+    pthread_mutex_lock(&mutex);
+    long result = dropped;
+    pthread_mutex_unlock(&mutex);
+    return result;
+}
+
+//everything a frame carries from capture to display.
+struct CameraFrame
+{
+    Mat img;
+    //shared by tracking, detection and recognition
+    GrayFrame gray;
+    Rect rects[81];
+    vector<Box> detected_boxes;
+    bool located;
+    //lock generation of the tracker when the grid was located, so that the
+    //next stages see a new grid even when the frame that locked it is dropped
+    long generation;
+    //cells classified again in this frame
+    int classified;
+    int data[81];
+    int result[81];
+    bool succeed;
+    //rows the frame was processed at, and the time spent in each stage
+    int rows;
+    double detect_ms;
+    double recognize_ms;
+};
+
+//picks the rows frames are resized to. the rows that fit the frame time
+//budget are estimated from the last frames, as the cost grows with the
+//number of pixels. a grid seen in the last frame lowers them when its
+//cells are larger than recognition needs, and raises them when its cells
+//would become too small to be read, whatever the budget.
+class ResolutionController
+{
+    public:
+
+    //budget_ms <= 0 only follows the grid.
+    ResolutionController(int min_rows, int max_rows, double budget_ms);
+    ~ResolutionController();
+
+    int get_rows();
+    int get_min_rows() {return min_rows;}
+    int get_max_rows() {return max_rows;}
+    double get_budget() {return budget_ms;}
+    //a frame processed at rows took frame_ms, and its cells were
+    //cell_side pixels wide (0 without grid).
+    void update(int rows, double frame_ms, double cell_side);
+
+    private:
+
+    ResolutionController(const ResolutionController&);
+    ResolutionController& operator=(const ResolutionController&);
+
+    int min_rows;
+    int max_rows;
+    double budget_ms;
+    int rows;
+    //smoothed frame time per pixel row squared
+    double cost;
+
+    pthread_mutex_t mutex;
+};
+
+//frames of the camera, a video file, a printf pattern such as
+//frames/%04d.png, a directory, a glob or a list file.
+class FrameSource
+{
+    public:
+
+    FrameSource() : next(0), live(false) {}
+
+    //camera 0 when name is empty.
+    bool open(string name);
+    bool read(Mat& frame);
+
+    bool is_live() {return live;}
+    //frame rate a recorded video should be played at, 0 when unknown.
+    double get_fps();
+
+    private:
+
+    VideoCapture cap;
+    vector<string> filenames;
+    size_t next;
+    bool live;
+};
+
+//capture, detection, recognition and display run on their own threads.
+void run_camera_pipeline(FrameSource& source, const SudokuModel& model, ResolutionController& resolution);
+void replay_benchmark(FrameSource& source, const SudokuModel& model, ResolutionController& resolution);
+
+#endif
@@ -34,8 +34,10 @@
 #include <opencv2/features2d/features2d.hpp>
 #include <ml.h>
 #include <algorithm>
+#include <climits>
 #include <numeric>
-#include "box.h"
+#include "sudokuez.h"
+#include "profiler.h"
 
 using namespace std;
 using namespace cv;
@@ -44,12 +46,14 @@ const int MIN_BOX_SIZE = 200;
 const int MAX_APPROX = 10;
 const double FITTING_SQUARE_AREA_RATIO = .8;
 const int MIN_BOXES_DISTANCE = 3;
-const int FEATURE_SIZE = 80;
-const int MAX_SAMPLES = 1000;
+//boxes are linked across diagonals and across one missing cell, so that
+//the boxes of a grid stay together when a row or a column is not found
+const double NEIGHBOUR_DISTANCE = 2.5;
+//every link advances at most 2 cells along one axis and 1 along the
+//other, so 7 linked boxes are needed to span 9 rows and 9 columns
+const size_t MIN_GRID_BOXES = 7;
 
 
-bool extract_feature(Mat, float [], Mat&);
-
 void morphology_filter(vector<vector<Point> >& contours, vector<Box>& boxes)
 {
     boxes.clear();
@@ -249,10 +253,9 @@ Mat get_cof_mat(Box* origin, map<Box*, Point>& offset)
     return (m.t() * m).inv() * m.t() * s;
 }
 
-Point get_fitted_coord(Point pos, Mat cof, Point origin_pos)
+Point get_fitted_coord(Point2d pos, Mat cof, Point origin_pos)
 {
     Mat pos_mat(pos);
-    pos_mat.convertTo(pos_mat, CV_64FC1);
     Mat result = pos_mat.t() * cof;
     return Point((int)result.at<double>(0, 0), (int)result.at<double>(0, 1)) + origin_pos;
 }
@@ -273,14 +276,171 @@ void show_boxes(Mat img, vector<Box>& boxes, Scalar color)
 }
 #endif
 
-bool get_cropped_imgs(Mat img, Mat cropped_imgs[], Rect rects[], vector<Box>& detected_boxes)
+bool larger_cluster(const vector<Box>& a, const vector<Box>& b)
+{
+    return a.size() > b.size();
+}
+
+bool higher_grid(const Grid& a, const Grid& b)
+{
+    return a.corners[0].y < b.corners[0].y;
+}
+
+bool reading_order(const pair<int, Grid*>& a, const pair<int, Grid*>& b)
+{
+    if (a.first != b.first)
+        return a.first < b.first;
+    return a.second->corners[0].x < b.second->corners[0].x;
+}
+
+//put grids in reading order: a grid whose top is less than the height of
+//the smallest grid below the top of the first grid of a row is on that
+//row, and the grids of a row are ordered from left to right.
+void order_grids(vector<Grid>& grids)
+{
+    int row_height = INT_MAX;
+    for (size_t i = 0; i < grids.size(); i++)
+        row_height = MIN(row_height, MAX(grids[i].corners[3].y - grids[i].corners[0].y, 1));
+    sort(grids.begin(), grids.end(), higher_grid);
+
+    vector<pair<int, Grid*> > rows;
+    int row = 0, row_top = 0;
+    for (size_t i = 0; i < grids.size(); i++)
+    {
+        if (i == 0 || grids[i].corners[0].y - row_top >= row_height)
+        {
+            row += 1;
+            row_top = grids[i].corners[0].y;
+        }
+        rows.push_back(make_pair(row, &grids[i]));
+    }
+    sort(rows.begin(), rows.end(), reading_order);
+
+    vector<Grid> ordered;
+    for (size_t i = 0; i < rows.size(); i++)
+        ordered.push_back(*rows[i].second);
+    grids.swap(ordered);
+}
+
+//remove the boxes inside grid, whose cells are already placed.
+void remove_covered(vector<Box>& boxes, Grid& grid)
+{
+    vector<Point> outline(grid.corners, grid.corners + 4);
+    vector<Box> rest;
+    for (size_t i = 0; i < boxes.size(); i++)
+    {
+        Point center = boxes[i].get_center();
+        if (pointPolygonTest(outline, Point2f((float)center.x, (float)center.y), false) < 0)
+            rest.push_back(boxes[i]);
+    }
+    boxes.swap(rest);
+}
+
+//split boxes into groups of boxes that are next to each other, so that
+//the grids of a page are searched one by one. the largest group comes first.
+void cluster_boxes(vector<Box>& boxes, vector<vector<Box> >& clusters)
+{
+    vector<int> label(boxes.size(), -1);
+    int count = 0;
+    for (size_t i = 0; i < boxes.size(); i++)
+    {
+        if (label[i] >= 0)
+            continue;
+        vector<size_t> stack(1, i);
+        label[i] = count;
+        while (!stack.empty())
+        {
+            size_t j = stack.back();
+            stack.pop_back();
+            for (size_t k = 0; k < boxes.size(); k++)
+            {
+                if (label[k] >= 0)
+                    continue;
+                double length = MAX(boxes[j].get_sidelength(), boxes[k].get_sidelength()) * NEIGHBOUR_DISTANCE;
+                if (dist(boxes[j].get_center(), boxes[k].get_center()) < length)
+                {
+                    label[k] = count;
+                    stack.push_back(k);
+                }
+            }
+        }
+        count += 1;
+    }
+
+    clusters.assign(count, vector<Box>());
+    for (size_t i = 0; i < boxes.size(); i++)
+        clusters[label[i]].push_back(boxes[i]);
+    sort(clusters.begin(), clusters.end(), larger_cluster);
+}
+
+//search the lattice of boxes from its first box and place its 81 cells.
+bool find_grid(Size size, vector<Box>& boxes, Grid& grid)
+{
+    //get offset of important boxes by finding neighbours of boxes
+    StageTimer timer(STAGE_OFFSET);
+    Box* origin = &boxes[0];
+    double length = origin->get_sidelength() * 1.1;
+    map<Box*, Point > offset;
+    offset[origin] = Point(0, 0);
+
+    int min_offx = 0, min_offy = 0, max_offx = 0, max_offy = 0;
+    bool succeed = get_offset(origin, offset[origin], boxes,
+                              length, offset,
+                              min_offx, min_offy, max_offx, max_offy);
+    if (!succeed)
+        return false;
+
+    timer.next(STAGE_COF_MAT);
+    Mat cof = get_cof_mat(origin, offset);
+
+    timer.next(STAGE_CROP);
+    int r = (int)(length / 2);
+    for (int y = 0; y < 9; y++)
+    {
+        int dy = y + min_offy;
+        for (int x = 0; x < 9; x++)
+        {
+            int dx = x + min_offx;
+            Point fp = get_fitted_coord(Point2d(dx, dy), cof, origin->get_center());
+            if (fp.x - r < 0 || fp.y - r < 0 || fp.x + r > size.width || fp.y + r > size.height)
+                return false;
+
+            grid.rects[y * 9 + x] = Rect(fp.x - r, fp.y - r, 2 * r, 2 * r);
+        }
+    }
+
+    double x0 = min_offx - .5, y0 = min_offy - .5;
+    grid.corners[0] = get_fitted_coord(Point2d(x0, y0), cof, origin->get_center());
+    grid.corners[1] = get_fitted_coord(Point2d(x0 + 9, y0), cof, origin->get_center());
+    grid.corners[2] = get_fitted_coord(Point2d(x0 + 9, y0 + 9), cof, origin->get_center());
+    grid.corners[3] = get_fitted_coord(Point2d(x0, y0 + 9), cof, origin->get_center());
+    return true;
+}
+
+//find up to max_grids grids (all of them when max_grids <= 0) in reading
+//order, with the given engine. cells are placed in
+//frame.gray, which prepare_frame() computed once for detection and
+//recognition.
+int get_grids(GrayFrame& frame, DetectionEngine engine, vector<Grid>& grids,
+              vector<Box>& detected_boxes, int max_grids)
 {
+    grids.clear();
+    detected_boxes.clear();
+    Grid hough_grid;
+    if (engine == ENGINE_HOUGH && get_hough_grid(frame, hough_grid))
+    {
+        grids.push_back(hough_grid);
+        return 1;
+    }
+
+    StageTimer timer(STAGE_THRESHOLD);
+    Mat img = frame.gray;
+
     //convert to binary
-    Mat gray, bin;
-    cvtColor(img, gray, CV_BGR2GRAY);
+    Mat bin;
     int block_size = (int)(MIN(img.cols,img.rows) * 0.1)|1;
 
-    adaptiveThreshold( gray, bin, 255,
+    adaptiveThreshold( img, bin, 255,
         CV_ADAPTIVE_THRESH_MEAN_C, CV_THRESH_BINARY_INV, block_size, 3 );
 
     //dilate img
@@ -295,9 +455,11 @@ bool get_cropped_imgs(Mat img, Mat cropped_imgs[], Rect rects[], vector<Box>& de
 #endif
 
     //find contours of img
+    timer.next(STAGE_CONTOURS);
     vector<vector<Point> > contours;
     vector<Vec4i> hierarchy;
     findContours(dil_bin, contours, hierarchy, CV_RETR_CCOMP, CV_CHAIN_APPROX_SIMPLE);
+    Profiler::count(COUNTER_CONTOURS, (long)contours.size());
 
 #ifdef SUDOKU_DEBUG
     cout << contours.size() << " contours found.\n";
@@ -309,18 +471,24 @@ bool get_cropped_imgs(Mat img, Mat cropped_imgs[], Rect rects[], vector<Box>& de
 #endif
 
     //get boxes from contours
+    timer.next(STAGE_MORPHOLOGY_FILTER);
     vector<Box> boxes;
     morphology_filter(contours, boxes);
+    Profiler::count(COUNTER_BOXES, (long)boxes.size());
 #ifdef SUDOKU_DEBUG
     show_boxes(img.clone(), boxes, Scalar(255, 0, 0));
 #endif
     detected_boxes = boxes;
 
+    timer.next(STAGE_MAJORITY_FILTER);
     majority_filter(boxes);
+    Profiler::count(COUNTER_MAJORITY_BOXES, (long)boxes.size());
 #ifdef SUDOKU_DEBUG
     show_boxes(img.clone(), boxes, Scalar(0, 255, 0));
 #endif
+    timer.next(STAGE_DISTINCT_FILTER);
     distinct_filter(boxes);
+    Profiler::count(COUNTER_DISTINCT_BOXES, (long)boxes.size());
 
 #ifdef SUDOKU_DEBUG
     show_boxes(img.clone(), boxes, Scalar(0, 0, 255));
@@ -344,37 +512,46 @@ bool get_cropped_imgs(Mat img, Mat cropped_imgs[], Rect rects[], vector<Box>& de
     fout.close();
 #endif
 
-    if (boxes.size() == 0)
-        return false;
-    //get offset of important boxes by finding neighbours of boxes
-    Box* origin = &boxes[0];
-    double length = origin->get_sidelength() * 1.1;
-    map<Box*, Point > offset;
-    offset[origin] = Point(0, 0);
-
-    int min_offx = 0, min_offy = 0, max_offx = 0, max_offy = 0;
-    bool succeed = get_offset(origin, offset[origin], boxes,
-                              length, offset,
-                              min_offx, min_offy, max_offx, max_offy);
-    if (succeed)
+    timer.next(STAGE_OFFSET);
+    vector<vector<Box> > clusters;
+    cluster_boxes(boxes, clusters);
+    timer.stop();
+    for (size_t i = 0; i < clusters.size(); i++)
     {
-        Mat cof = get_cof_mat(origin, offset);
-
-        int r = (int)(length / 2);
-        for (int y = 0; y < 9; y++)
+        //grids close to each other can share a cluster, so the boxes of
+        //every grid found are removed and the rest is searched again
+        vector<Box>& cluster = clusters[i];
+        while (cluster.size() >= MIN_GRID_BOXES)
         {
-            int dy = y + min_offy;
-            for (int x = 0; x < 9; x++)
-            {
-                int dx = x + min_offx;
-                Point fp = get_fitted_coord(Point(dx, dy), cof, origin->get_center());
-
-                cropped_imgs[y * 9 + x] = img.rowRange(fp.y - r, fp.y + r).colRange(fp.x - r, fp.x + r);
-                rects[y * 9 + x] = Rect(fp.x - r, fp.y - r, 2 * r, 2 * r);
-            }
+            if (max_grids > 0 && (int)grids.size() >= max_grids)
+                break;
+            Grid grid;
+            if (!find_grid(Size(frame.gray.cols, frame.gray.rows), cluster, grid))
+                break;
+            grids.push_back(grid);
+            size_t before = cluster.size();
+            remove_covered(cluster, grid);
+            if (cluster.size() == before)
+                break;
         }
     }
 
-    return succeed;
+    order_grids(grids);
+    return (int)grids.size();
+}
+
+//the cells of the largest grid of the frame.
+bool get_cropped_imgs(GrayFrame& frame, DetectionEngine engine, Mat cropped_imgs[],
+                      Rect rects[], vector<Box>& detected_boxes)
+{
+    vector<Grid> grids;
+    if (get_grids(frame, engine, grids, detected_boxes, 1) == 0)
+        return false;
+    for (int i = 0; i < 81; i++)
+    {
+        rects[i] = grids[0].rects[i];
+        cropped_imgs[i] = frame.gray(rects[i]);
+    }
+    return true;
 }
 
@@ -0,0 +1,312 @@
+/*
+* This file is part of SudokuEz
+*
+* Copyright (C) 2012-2017 Zhong Xu
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*/
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <cmath>
+#include <pthread.h>
+#include <opencv2/core/core.hpp>
+#include "profiler.h"
+
+using namespace std;
+using namespace cv;
+
+//4 buckets per power of two of microseconds, up to about an hour.
+const int HISTOGRAM_BUCKETS = 1 + 4 * 32;
+const size_t MAX_TRACE_EVENTS = 1 << 20;
+
+const char* STAGE_NAMES[STAGE_COUNT] =
+{
+    "decode", "resize", "grayscale", "hough_lines", "threshold", "find_contours",
+    "morphology_filter", "majority_filter", "distinct_filter",
+    "get_offset", "get_cof_mat", "crop", "track", "cell_signature",
+    "extract_feature", "predict", "solve", "render"
+};
+
+const char* COUNTER_NAMES[COUNTER_COUNT] =
+{
+    "contours", "boxes", "majority_boxes", "distinct_boxes"
+};
+
+struct StageHistogram
+{
+    long long count;
+    long long total_ns;
+    long long max_ns;
+    long long buckets[HISTOGRAM_BUCKETS];
+};
+
+struct CounterTotal
+{
+    long long samples;
+    long long total;
+};
+
+struct TraceEvent
+{
+    int stage;
+    int counter;
+    int tid;
+    int64 begin;
+    int64 end;
+    long value;
+};
+
+bool Profiler::enabled = false;
+bool Profiler::trace = false;
+
+StageHistogram histograms[STAGE_COUNT];
+CounterTotal counters[COUNTER_COUNT];
+vector<TraceEvent> events;
+pthread_mutex_t events_mutex = PTHREAD_MUTEX_INITIALIZER;
+int64 start_tick = 0;
+int next_tid = 0;
+__thread int thread_tid = -1;
+
+int bucket_of(long long us)
+{
+    if (us < 1)
+        return 0;
+    int msb = 63 - __builtin_clzll((unsigned long long)us);
+    int sub = msb >= 2 ? (int)((us >> (msb - 2)) & 3) : (int)((us << (2 - msb)) & 3);
+    return MIN(1 + msb * 4 + sub, HISTOGRAM_BUCKETS - 1);
+}
+
+//upper bound of a bucket in milliseconds
+double bucket_limit(int bucket)
+{
+    if (bucket == 0)
+        return .001;
+    int msb = (bucket - 1) / 4, sub = (bucket - 1) % 4;
+    return ldexp(1. + (sub + 1) / 4., msb) / 1000.;
+}
+
+double percentile(StageHistogram& h, double p)
+{
+    long long rank = (long long)(p / 100. * (double)h.count + .5), seen = 0;
+    for (int b = 0; b < HISTOGRAM_BUCKETS; b++)
+    {
+        seen += h.buckets[b];
+        if (seen >= rank && seen > 0)
+            return MIN(bucket_limit(b), (double)h.max_ns / 1e6);
+    }
+    return (double)h.max_ns / 1e6;
+}
+
+int get_tid()
+{
+    if (thread_tid < 0)
+        thread_tid = __sync_fetch_and_add(&next_tid, 1);
+    return thread_tid;
+}
+
+void record_event(TraceEvent& e)
+{
+    pthread_mutex_lock(&events_mutex);
+    if (events.size() < MAX_TRACE_EVENTS)
+        events.push_back(e);
+    pthread_mutex_unlock(&events_mutex);
+}
+
+void Profiler::enable(bool trace)
+{
+    Profiler::trace = trace;
+    start_tick = getTickCount();
+    enabled = true;
+}
+
+void Profiler::add(Stage stage, int64 begin, int64 end)
+{
+    if (!enabled)
+        return;
+    long long ns = (long long)((double)(end - begin) * 1e9 / getTickFrequency());
+    StageHistogram& h = histograms[stage];
+    __sync_fetch_and_add(&h.count, 1);
+    __sync_fetch_and_add(&h.total_ns, ns);
+    __sync_fetch_and_add(&h.buckets[bucket_of(ns / 1000)], 1);
+    long long old = h.max_ns;
+    while (ns > old && !__sync_bool_compare_and_swap(&h.max_ns, old, ns))
+        old = h.max_ns;
+
+    if (trace)
+    {
+        TraceEvent e = {stage, -1, get_tid(), begin, end, 0};
+        record_event(e);
+    }
+}
+
+void Profiler::count(Counter counter, long value)
+{
+    if (!enabled)
+        return;
+    __sync_fetch_and_add(&counters[counter].samples, 1);
+    __sync_fetch_and_add(&counters[counter].total, value);
+
+    if (trace)
+    {
+        int64 now = getTickCount();
+        TraceEvent e = {-1, counter, get_tid(), now, now, value};
+        record_event(e);
+    }
+}
+
+void write_json(ofstream& fout)
+{
+    fout << "{\"stages\": [";
+    bool first = true;
+    for (int s = 0; s < STAGE_COUNT; s++)
+    {
+        StageHistogram& h = histograms[s];
+        if (h.count == 0)
+            continue;
+        fout << (first ? "\n" : ",\n") << "  {\"name\": \"" << STAGE_NAMES[s] << "\""
+             << ", \"count\": " << h.count
+             << ", \"total_ms\": " << (double)h.total_ns / 1e6
+             << ", \"mean_ms\": " << (double)h.total_ns / 1e6 / (double)h.count
+             << ", \"p50_ms\": " << percentile(h, 50)
+             << ", \"p95_ms\": " << percentile(h, 95)
+             << ", \"p99_ms\": " << percentile(h, 99)
+             << ", \"max_ms\": " << (double)h.max_ns / 1e6
+             << ", \"histogram\": [";
+        bool first_bucket = true;
+        for (int b = 0; b < HISTOGRAM_BUCKETS; b++)
+        {
+            if (h.buckets[b] == 0)
+                continue;
+            fout << (first_bucket ? "" : ", ") << "{\"le_ms\": " << bucket_limit(b)
+                 << ", \"count\": " << h.buckets[b] << "}";
+            first_bucket = false;
+        }
+        fout << "]}";
+        first = false;
+    }
+    fout << "\n], \"counters\": [";
+    first = true;
+    for (int c = 0; c < COUNTER_COUNT; c++)
+    {
+        CounterTotal& t = counters[c];
+        if (t.samples == 0)
+            continue;
+        fout << (first ? "\n" : ",\n") << "  {\"name\": \"" << COUNTER_NAMES[c] << "\""
+             << ", \"samples\": " << t.samples
+             << ", \"total\": " << t.total
+             << ", \"mean\": " << (double)t.total / (double)t.samples << "}";
+        first = false;
+    }
+    fout << "\n]}" << endl;
+}
+
+void write_csv(ofstream& fout)
+{
+    fout << "kind,name,count,total,mean,p50,p95,p99,max" << endl;
+    for (int s = 0; s < STAGE_COUNT; s++)
+    {
+        StageHistogram& h = histograms[s];
+        if (h.count == 0)
+            continue;
+        fout << "stage_ms," << STAGE_NAMES[s] << "," << h.count
+             << "," << (double)h.total_ns / 1e6
+             << "," << (double)h.total_ns / 1e6 / (double)h.count
+             << "," << percentile(h, 50)
+             << "," << percentile(h, 95)
+             << "," << percentile(h, 99)
+             << "," << (double)h.max_ns / 1e6 << endl;
+    }
+    for (int c = 0; c < COUNTER_COUNT; c++)
+    {
+        CounterTotal& t = counters[c];
+        if (t.samples == 0)
+            continue;
+        fout << "counter," << COUNTER_NAMES[c] << "," << t.samples << "," << t.total
+             << "," << (double)t.total / (double)t.samples << ",,,," << endl;
+    }
+}
+
+void write_trace(ofstream& fout)
+{
+    double us_per_tick = 1e6 / getTickFrequency();
+    pthread_mutex_lock(&events_mutex);
+    fout << "{\"traceEvents\": [";
+    for (size_t i = 0; i < events.size(); i++)
+    {
+        TraceEvent& e = events[i];
+        double ts = (double)(e.begin - start_tick) * us_per_tick;
+        fout << (i == 0 ? "\n" : ",\n");
+        if (e.stage >= 0)
+            fout << "  {\"name\": \"" << STAGE_NAMES[e.stage] << "\", \"ph\": \"X\", \"ts\": " << ts
+                 << ", \"dur\": " << (double)(e.end - e.begin) * us_per_tick;
+        else
+            fout << "  {\"name\": \"" << COUNTER_NAMES[e.counter] << "\", \"ph\": \"C\", \"ts\": " << ts
+                 << ", \"args\": {\"value\": " << e.value << "}";
+        fout << ", \"pid\": 1, \"tid\": " << e.tid << "}";
+    }
+    fout << "\n]}" << endl;
+    pthread_mutex_unlock(&events_mutex);
+}
+
+bool Profiler::write(string filename)
+{
+    ofstream fout(filename.c_str());
+    if (!fout)
+        return false;
+    fout << fixed << setprecision(3);
+
+    size_t dot = filename.rfind('.');
+    string ext = dot == string::npos ? "" : filename.substr(dot);
+    if (ext == ".csv")
+        write_csv(fout);
+    else if (ext == ".trace")
+        write_trace(fout);
+    else
+        write_json(fout);
+    return true;
+}
+
+StageTimer::StageTimer(Stage stage)
+{
+    this->stage = stage;
+    running = Profiler::is_enabled();
+    begin = running ? getTickCount() : 0;
+}
+
+void StageTimer::next(Stage stage)
+{
+    if (!running)
+        return;
+    int64 now = getTickCount();
+    Profiler::add(this->stage, begin, now);
+    this->stage = stage;
+    begin = now;
+}
+
+void StageTimer::stop()
+{
+    if (!running)
+        return;
+    Profiler::add(stage, begin, getTickCount());
+    running = false;
+}
@@ -0,0 +1,113 @@
+/*
+* This file is part of SudokuEz
+*
+* Copyright (C) 2012-2017 Zhong Xu
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <string>
+#include <opencv2/core/core.hpp>
+
+using namespace std;
+using namespace cv;
+
+enum Stage
+{
+    STAGE_DECODE,
+    STAGE_RESIZE,
+    STAGE_GRAYSCALE,
+    STAGE_HOUGH,
+    STAGE_THRESHOLD,
+    STAGE_CONTOURS,
+    STAGE_MORPHOLOGY_FILTER,
+    STAGE_MAJORITY_FILTER,
+    STAGE_DISTINCT_FILTER,
+    STAGE_OFFSET,
+    STAGE_COF_MAT,
+    STAGE_CROP,
+    STAGE_TRACK,
+    STAGE_SIGNATURE,
+    STAGE_FEATURE,
+    STAGE_PREDICT,
+    STAGE_SOLVE,
+    STAGE_RENDER,
+    STAGE_COUNT
+};
+
+enum Counter
+{
+    COUNTER_CONTOURS,
+    COUNTER_BOXES,
+    COUNTER_MAJORITY_BOXES,
+    COUNTER_DISTINCT_BOXES,
+    COUNTER_COUNT
+};
+
+//always compiled in, but nothing is measured until enable() is called, so
+//a disabled profiler costs one branch per stage.
+class Profiler
+{
+    public:
+
+    //events for a chrome trace are only kept when trace is true.
+    static void enable(bool trace);
+    static bool is_enabled() {return enabled;}
+
+    static void add(Stage stage, int64 begin, int64 end);
+    static void count(Counter counter, long value);
+
+    //the format follows the extension: .json and .csv get per-stage
+    //histograms and counters, .trace gets chrome://tracing events.
+    static bool write(string filename);
+
+    private:
+
+    static bool enabled;
+    static bool trace;
+};
+
+//measures consecutive stages of one function:
+//    StageTimer timer(STAGE_THRESHOLD);
+//    ...
+//    timer.next(STAGE_CONTOURS);
+//    ...
+//the last stage ends when the timer goes out of scope.
+class StageTimer
+{
+    public:
+
+    StageTimer(Stage stage);
+    ~StageTimer() {stop();}
+
+    void next(Stage stage);
+    void stop();
+
+    private:
+
+    Stage stage;
+    int64 begin;
+    bool running;
+};
+
+#endif
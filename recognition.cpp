@@ -0,0 +1,108 @@
+/*
+* This file is part of SudokuEz
+*
+* Copyright (C) 2012-2017 Zhong Xu
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*/
+
+//#define SUDOKU_DEBUG
+
+#include <sstream>
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <ml.h>
+#include "sudokuez.h"
+#include "profiler.h"
+
+using namespace std;
+using namespace cv;
+
+
+//the digit of the cell at rect, 0 when it is empty.
+int recognize_cell(GrayFrame& frame, Rect rect, const CvSVM& svm)
+{
+    float feature[FEATURE_SIZE];
+    int value = 0;
+    Mat pimg;
+    StageTimer timer(STAGE_FEATURE);
+    if (extract_feature(frame, rect, feature, pimg))
+    {
+        timer.next(STAGE_PREDICT);
+        Mat test(1, FEATURE_SIZE, CV_32FC1, Scalar::all(0));
+        for (int j = 0; j < FEATURE_SIZE; j++)
+            test.at<float>(0, j) = feature[j];
+        value = (int)svm.predict(test);
+    }
+    return value;
+}
+
+void recognize_digits(GrayFrame& frame, Rect rects[], const CvSVM& svm, int data[])
+{
+    for (int i = 0; i < 81; i++)
+        data[i] = recognize_cell(frame, rects[i], svm);
+}
+
+bool get_solution(GrayFrame& frame, Rect rects[], const CvSVM& svm, int data[], int result[])
+{
+    //recognize numbers
+    recognize_digits(frame, rects, svm, data);
+    //solve sudoku
+    StageTimer timer(STAGE_SOLVE);
+    for (int i = 0; i < 81; i++)
+        result[i] = data[i];
+    return go(data, 0, result);
+}
+
+void draw_solution(Mat& img, int data[], int result[], Rect rects[])
+{
+    StageTimer timer(STAGE_RENDER);
+    for (int i = 0; i < 81; i++)
+    {
+        Point p1(rects[i].x, rects[i].y);
+        Point p2(rects[i].x + rects[i].width, rects[i].y + rects[i].height);
+        rectangle(img, p1, p2, Scalar(0, 0, 255), 3);
+    }
+    for (int i = 0; i < 81; i++)
+    {
+        Point p1(rects[i].x, rects[i].y);
+        Point p2(rects[i].x + rects[i].width, rects[i].y + rects[i].height);
+        Point p3(rects[i].x, rects[i].y + rects[i].height);
+        stringstream ss;
+        ss << result[i];
+        Scalar color;
+        if (data[i] == 0)
+            color = Scalar(0, 0, 255);
+        else
+            color = Scalar(255, 0, 0);
+        putText(img, ss.str(), p3, FONT_HERSHEY_SIMPLEX, 2, color, 2);
+    }
+}
+
+void draw_detected_boxes(Mat& img, vector<Box>& detected_boxes)
+{
+    vector<vector<Point> > boxes_contours;
+    for (vector<Box>::iterator ib = detected_boxes.begin(); ib < detected_boxes.end(); ib++)
+    {
+        boxes_contours.push_back(ib->get_contour());
+    }
+
+    drawContours(img, boxes_contours, -1, Scalar(0, 255, 0), 3);
+}
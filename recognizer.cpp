@@ -0,0 +1,166 @@
+/*
+* This file is part of SudokuEz
+*
+* Copyright (C) 2012-2017 Zhong Xu
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*/
+
+//#define SUDOKU_DEBUG
+
+#include <iostream>
+#include <algorithm>
+#include <opencv2/core/core.hpp>
+#include <ml.h>
+#include "recognizer.h"
+#include "sudokuez.h"
+#include "profiler.h"
+
+using namespace std;
+using namespace cv;
+
+const int SIGNATURE_BLOCKS = 8;
+//cells whose block means differ by less than this are blank
+const int BLANK_CONTRAST = 24;
+//signatures further apart than this many bits are a changed cell
+const int CHANGED_BITS = 8;
+//votes the digit of every cell needs before the grid is stable
+const int STABLE_VOTES = 3;
+
+
+GridRecognizer::GridRecognizer()
+{
+    generation = -1;
+    reset();
+}
+
+void GridRecognizer::follow(long generation)
+{
+    if (generation == this->generation)
+        return;
+    this->generation = generation;
+    reset();
+}
+
+void GridRecognizer::reset()
+{
+    for (int i = 0; i < 81; i++)
+    {
+        known[i] = false;
+        signatures[i] = 0;
+        for (int d = 0; d < 10; d++)
+            votes[i][d] = 0;
+    }
+    classified = 0;
+    solved = false;
+}
+
+//bit k is set when block k of the inner cell is brighter than the mean of
+//the blocks. the block means come from the integral image, so a signature
+//costs 64 lookups whatever the size of the cell. blank cells are 0.
+uint64 GridRecognizer::signature(GrayFrame& frame, Rect rect)
+{
+    int side = rect.height;
+    int begin = (int)(side * .1), end = (int)(side * .9);
+    Rect inner(rect.x + begin, rect.y + begin, end - begin, end - begin);
+    inner &= Rect(0, 0, frame.gray.cols, frame.gray.rows);
+    if (inner.width < SIGNATURE_BLOCKS || inner.height < SIGNATURE_BLOCKS)
+        return 0;
+
+    int means[SIGNATURE_BLOCKS * SIGNATURE_BLOCKS];
+    int total = 0, low = 255, high = 0;
+    for (int by = 0; by < SIGNATURE_BLOCKS; by++)
+    {
+        int y0 = inner.y + inner.height * by / SIGNATURE_BLOCKS;
+        int y1 = inner.y + inner.height * (by + 1) / SIGNATURE_BLOCKS;
+        for (int bx = 0; bx < SIGNATURE_BLOCKS; bx++)
+        {
+            int x0 = inner.x + inner.width * bx / SIGNATURE_BLOCKS;
+            int x1 = inner.x + inner.width * (bx + 1) / SIGNATURE_BLOCKS;
+            int s = frame.sum.at<int>(y1, x1) - frame.sum.at<int>(y0, x1)
+                  - frame.sum.at<int>(y1, x0) + frame.sum.at<int>(y0, x0);
+            int mean = s / ((y1 - y0) * (x1 - x0));
+            means[by * SIGNATURE_BLOCKS + bx] = mean;
+            total += mean;
+            low = MIN(low, mean);
+            high = MAX(high, mean);
+        }
+    }
+    if (high - low < BLANK_CONTRAST)
+        return 0;
+
+    int average = total / (SIGNATURE_BLOCKS * SIGNATURE_BLOCKS);
+    uint64 result = 0;
+    for (int k = 0; k < SIGNATURE_BLOCKS * SIGNATURE_BLOCKS; k++)
+        if (means[k] > average)
+            result |= (uint64)1 << k;
+    return result;
+}
+
+bool GridRecognizer::recognize(GrayFrame& frame, Rect rects[], const CvSVM& svm, int data[])
+{
+    classified = 0;
+    bool stable = true;
+    for (int i = 0; i < 81; i++)
+    {
+        StageTimer timer(STAGE_SIGNATURE);
+        uint64 s = signature(frame, rects[i]);
+        timer.stop();
+        bool changed = known[i] && __builtin_popcountll(s ^ signatures[i]) > CHANGED_BITS;
+        int* v = votes[i];
+        int leader = (int)(max_element(v, v + 10) - v);
+
+        if (!known[i] || changed || v[leader] < STABLE_VOTES)
+        {
+            //older votes count for less once the cell looks different
+            if (changed)
+                for (int d = 0; d < 10; d++)
+                    v[d] /= 2;
+            int value = recognize_cell(frame, rects[i], svm);
+            if (value >= 0 && value <= 9)
+                v[value] += 1;
+            known[i] = true;
+            signatures[i] = s;
+            classified += 1;
+            leader = (int)(max_element(v, v + 10) - v);
+        }
+
+        data[i] = leader;
+        stable = stable && v[leader] >= STABLE_VOTES;
+    }
+#ifdef SUDOKU_DEBUG
+    cout << classified << " cells classified, " << (stable ? "stable" : "not stable") << endl;
+#endif
+    return stable;
+}
+
+bool GridRecognizer::solve(int data[], int result[])
+{
+    if (!solved || !equal(data, data + 81, solved_data))
+    {
+        StageTimer timer(STAGE_SOLVE);
+        copy(data, data + 81, solved_data);
+        copy(data, data + 81, solved_result);
+        solution_found = go(solved_data, 0, solved_result);
+        solved = true;
+    }
+    copy(solved_result, solved_result + 81, result);
+    return solution_found;
+}
@@ -0,0 +1,78 @@
+/*
+* This file is part of SudokuEz
+*
+* Copyright (C) 2012-2017 Zhong Xu
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*/
+
+#ifndef RECOGNIZER_H
+#define RECOGNIZER_H
+
+#include <opencv2/core/core.hpp>
+#include <ml.h>
+#include "frame.h"
+
+using namespace std;
+using namespace cv;
+
+//recognizes a tracked grid over many frames. every cell keeps a 64 bit
+//signature of its 8x8 block means, and is only classified again when the
+//signature changes or when it has too few votes. predictions are votes,
+//and the digit of a cell is its most voted one, so one noisy frame does
+//not change the grid.
+class GridRecognizer
+{
+    public:
+
+    GridRecognizer();
+
+    //forget every cell, for a grid that was located anew.
+    void reset();
+    //reset() when generation is not the tracker lock the cells were
+    //recognized from.
+    void follow(long generation);
+
+    //update the cells of frame at rects and put their digits in data.
+    //returns true once every digit has enough votes.
+    bool recognize(GrayFrame& frame, Rect rects[], const CvSVM& svm, int data[]);
+    //solve data, reusing the last solution when data did not change.
+    bool solve(int data[], int result[]);
+
+    //cells classified by the last recognize()
+    int get_classified() {return classified;}
+
+    private:
+
+    static uint64 signature(GrayFrame& frame, Rect rect);
+
+    bool known[81];
+    uint64 signatures[81];
+    int votes[81][10];
+    int classified;
+    long generation;
+
+    bool solved;
+    bool solution_found;
+    int solved_data[81];
+    int solved_result[81];
+};
+
+#endif
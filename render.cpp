@@ -0,0 +1,129 @@
+/*
+* This file is part of SudokuEz
+*
+* Copyright (C) 2012-2017 Zhong Xu
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*/
+
+//#define SUDOKU_DEBUG
+
+#include <sstream>
+#include <algorithm>
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include "render.h"
+#include "profiler.h"
+
+using namespace std;
+using namespace cv;
+
+const int BORDER_THICKNESS = 3;
+const double GLYPH_SCALE = 2.0;
+const int GLYPH_THICKNESS = 2;
+
+
+SolutionRenderer::SolutionRenderer()
+{
+    atlas = Mat::zeros(OVERLAY_CELL, OVERLAY_CELL * 9, CV_8UC1);
+    for (int d = 1; d <= 9; d++)
+    {
+        stringstream ss;
+        ss << d;
+        int baseline;
+        Size size = getTextSize(ss.str(), FONT_HERSHEY_SIMPLEX, GLYPH_SCALE, GLYPH_THICKNESS, &baseline);
+        Point origin((d - 1) * OVERLAY_CELL + (OVERLAY_CELL - size.width) / 2,
+                     (OVERLAY_CELL + size.height) / 2);
+        putText(atlas, ss.str(), origin, FONT_HERSHEY_SIMPLEX, GLYPH_SCALE, Scalar(255), GLYPH_THICKNESS);
+    }
+    composed = false;
+}
+
+void SolutionRenderer::compose(int data[], int result[])
+{
+    if (composed && equal(data, data + 81, composed_data) && equal(result, result + 81, composed_result))
+        return;
+
+    int side = OVERLAY_CELL * 9;
+    overlay = Mat::zeros(side, side, CV_8UC3);
+    mask = Mat::zeros(side, side, CV_8UC1);
+    for (int i = 0; i < 81; i++)
+    {
+        Rect cell(i % 9 * OVERLAY_CELL, i / 9 * OVERLAY_CELL, OVERLAY_CELL, OVERLAY_CELL);
+        rectangle(overlay, cell, Scalar(0, 0, 255), BORDER_THICKNESS);
+        rectangle(mask, cell, Scalar(255), BORDER_THICKNESS);
+
+        if (result[i] < 1 || result[i] > 9)
+            continue;
+        Mat glyph = atlas.colRange((result[i] - 1) * OVERLAY_CELL, result[i] * OVERLAY_CELL);
+        Scalar color = data[i] == 0 ? Scalar(0, 0, 255) : Scalar(255, 0, 0);
+        Mat cell_overlay = overlay(cell), cell_mask = mask(cell);
+        cell_overlay.setTo(color, glyph);
+        cell_mask.setTo(Scalar(255), glyph);
+    }
+
+    copy(data, data + 81, composed_data);
+    copy(result, result + 81, composed_result);
+    composed = true;
+}
+
+void SolutionRenderer::draw(Mat& img, int data[], int result[], Rect rects[])
+{
+    StageTimer timer(STAGE_RENDER);
+    compose(data, result);
+
+    //the centers of three corner cells give the affine map of the lattice
+    Point2f src[3], dst[3];
+    int cells[3] = {0, 8, 72};
+    for (int k = 0; k < 3; k++)
+    {
+        int i = cells[k];
+        src[k] = Point2f(((float)(i % 9) + .5f) * OVERLAY_CELL, ((float)(i / 9) + .5f) * OVERLAY_CELL);
+        dst[k] = Point2f((float)rects[i].x + (float)rects[i].width / 2,
+                         (float)rects[i].y + (float)rects[i].height / 2);
+    }
+    Mat m = getAffineTransform(src, dst);
+
+    //only the part of img under the grid is warped
+    float side = (float)(OVERLAY_CELL * 9);
+    vector<Point2f> outline(4), warped_outline;
+    outline[1] = Point2f(side, 0);
+    outline[2] = Point2f(side, side);
+    outline[3] = Point2f(0, side);
+    transform(outline, warped_outline, m);
+    Rect roi = boundingRect(warped_outline) & Rect(0, 0, img.cols, img.rows);
+    if (roi.width <= 0 || roi.height <= 0)
+        return;
+    m.at<double>(0, 2) -= roi.x;
+    m.at<double>(1, 2) -= roi.y;
+
+    //nearest neighbours keep the colors and the mask aligned
+    Mat warped, warped_mask;
+    warpAffine(overlay, warped, m, roi.size(), INTER_NEAREST);
+    warpAffine(mask, warped_mask, m, roi.size(), INTER_NEAREST);
+    Mat target = img(roi);
+    warped.copyTo(target, warped_mask);
+}
+
+void SolutionRenderer::draw(const Mat& img, int data[], int result[], Rect rects[], Mat& output)
+{
+    img.copyTo(output);
+    draw(output, data, result, rects);
+}
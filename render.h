@@ -0,0 +1,68 @@
+/*
+* This file is part of SudokuEz
+*
+* Copyright (C) 2012-2017 Zhong Xu
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*/
+
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <opencv2/core/core.hpp>
+
+
+using namespace std;
+using namespace cv;
+
+//side of a cell of the overlay, before it is warped onto the grid
+const int OVERLAY_CELL = 64;
+
+//draws solutions like draw_solution(), but the digits 1-9 are rasterized
+//once into an atlas and the overlay of a grid is only composed again when
+//its digits change. every frame then costs one warp of the overlay onto
+//the cells, whatever the digits.
+class SolutionRenderer
+{
+    public:
+
+    SolutionRenderer();
+
+    //draw the solution on img in place.
+    void draw(Mat& img, int data[], int result[], Rect rects[]);
+    //draw the solution on a copy of img in output, img is left untouched.
+    void draw(const Mat& img, int data[], int result[], Rect rects[], Mat& output);
+
+    private:
+
+    void compose(int data[], int result[]);
+
+    //glyph of digit d in columns (d - 1) * OVERLAY_CELL of a gray image
+    Mat atlas;
+
+    //the composed grid: colors and where they are drawn
+    Mat overlay;
+    Mat mask;
+    int composed_data[81];
+    int composed_result[81];
+    bool composed;
+};
+
+#endif
@@ -0,0 +1,637 @@
+/*
+* This file is part of SudokuEz
+*
+* Copyright (C) 2012-2017 Zhong Xu
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*/
+
+//#define SUDOKU_DEBUG
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <deque>
+#include <set>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <unistd.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <pthread.h>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include "sudokuez.h"
+#include "pipeline.h"
+#include "batch.h"
+#include "modes.h"
+#include "stats.h"
+#include "profiler.h"
+
+using namespace std;
+using namespace cv;
+
+const size_t MAX_IMAGE_BYTES = 64 << 20;
+const size_t JOBS_PER_WORKER = 4;
+const size_t READ_BUFFER_SIZE = 1 << 16;
+//requests of one connection that are queued, running or waiting to be
+//written back. a client that does not read its replies stops being read
+//once it reaches this, without holding any worker.
+const long MAX_PENDING_REPLIES = 16;
+
+
+struct Server;
+
+//one client. it is released by its reader and by every job it has queued.
+//replies are queued by the workers and written by the writer thread of the
+//connection, so a slow client only blocks its own writer.
+struct Connection
+{
+    Server* server;
+    int in_fd;
+    int out_fd;
+    bool owns_fds;
+    int refs;
+    long next_id;
+
+    deque<string> replies;
+    //replies promised by reserve_reply() and not written yet
+    long pending;
+    bool reading;
+    bool broken;
+    pthread_cond_t reply_ready;
+    pthread_cond_t reply_room;
+    pthread_mutex_t mutex;
+};
+
+struct ServerJob
+{
+    Connection* conn;
+    long id;
+    string filename;
+    Mat bytes;
+    int64 received;
+};
+
+struct Server
+{
+    Server(const SudokuModel& model, int workers);
+    ~Server();
+
+    const SudokuModel& model;
+    int workers;
+    BoundedQueue<ServerJob> jobs;
+    LatencyStats latency;
+    int64 start;
+
+    long requests;
+    long completed;
+    long solved;
+    long failed;
+    long in_flight;
+    //socket clients, which are shut down to stop the server
+    set<int> clients;
+    int connections;
+    pthread_mutex_t mutex;
+    pthread_cond_t idle;
+};
+
+//set by SIGINT and SIGTERM, which are only delivered while the accept
+//loop waits.
+volatile sig_atomic_t stop_requested = 0;
+
+void request_stop(int)
+{
+    stop_requested = 1;
+}
+
+Server::Server(const SudokuModel& model, int workers)
+    : model(model), jobs(workers * JOBS_PER_WORKER)
+{
+    this->workers = workers;
+    start = getTickCount();
+    requests = completed = solved = failed = in_flight = 0;
+    connections = 0;
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&idle, NULL);
+}
+
+Server::~Server()
+{
+    pthread_cond_destroy(&idle);
+    pthread_mutex_destroy(&mutex);
+}
+
+//buffered reads of request lines and image bytes from a file descriptor.
+class FdReader
+{
+    public:
+
+    FdReader(int fd) : fd(fd), buffer(READ_BUFFER_SIZE), begin(0), end(0) {}
+
+    bool read_line(string& line)
+    {
+        line.clear();
+        while (true)
+        {
+            if (begin == end && !fill())
+                return !line.empty();
+            char c = buffer[begin++];
+            if (c == '\n')
+                break;
+            if (c != '\r')
+                line += c;
+        }
+        return true;
+    }
+
+    bool read_bytes(uchar* dest, size_t n)
+    {
+        while (n > 0)
+        {
+            if (begin == end && !fill())
+                return false;
+            size_t k = MIN(n, end - begin);
+            memcpy(dest, &buffer[begin], k);
+            begin += k;
+            dest += k;
+            n -= k;
+        }
+        return true;
+    }
+
+    private:
+
+    bool fill()
+    {
+        ssize_t n;
+        do
+            n = read(fd, &buffer[0], buffer.size());
+        while (n < 0 && errno == EINTR);
+        begin = 0;
+        end = n > 0 ? (size_t)n : 0;
+        return n > 0;
+    }
+
+    int fd;
+    vector<char> buffer;
+    size_t begin, end;
+};
+
+Connection* open_connection(Server* server, int in_fd, int out_fd, bool owns_fds)
+{
+    Connection* conn = new Connection;
+    conn->server = server;
+    conn->in_fd = in_fd;
+    conn->out_fd = out_fd;
+    conn->owns_fds = owns_fds;
+    conn->refs = 1;
+    conn->next_id = 0;
+    conn->pending = 0;
+    conn->reading = true;
+    conn->broken = false;
+    pthread_cond_init(&conn->reply_ready, NULL);
+    pthread_cond_init(&conn->reply_room, NULL);
+    pthread_mutex_init(&conn->mutex, NULL);
+    return conn;
+}
+
+void acquire_connection(Connection* conn)
+{
+    pthread_mutex_lock(&conn->mutex);
+    conn->refs += 1;
+    pthread_mutex_unlock(&conn->mutex);
+}
+
+void release_connection(Connection* conn)
+{
+    pthread_mutex_lock(&conn->mutex);
+    conn->refs -= 1;
+    bool last = conn->refs == 0;
+    pthread_mutex_unlock(&conn->mutex);
+    if (!last)
+        return;
+
+    if (conn->owns_fds)
+    {
+        pthread_mutex_lock(&conn->server->mutex);
+        conn->server->clients.erase(conn->in_fd);
+        pthread_mutex_unlock(&conn->server->mutex);
+        close(conn->in_fd);
+        if (conn->out_fd != conn->in_fd)
+            close(conn->out_fd);
+    }
+    pthread_cond_destroy(&conn->reply_ready);
+    pthread_cond_destroy(&conn->reply_room);
+    pthread_mutex_destroy(&conn->mutex);
+    delete conn;
+}
+
+//wait until the connection has room for one more reply, which the reader
+//does before every request.
+void reserve_reply(Connection* conn)
+{
+    pthread_mutex_lock(&conn->mutex);
+    while (conn->pending >= MAX_PENDING_REPLIES)
+        pthread_cond_wait(&conn->reply_room, &conn->mutex);
+    conn->pending += 1;
+    pthread_mutex_unlock(&conn->mutex);
+}
+
+//give back a reservation that will not be answered.
+void cancel_reply(Connection* conn)
+{
+    pthread_mutex_lock(&conn->mutex);
+    conn->pending -= 1;
+    pthread_cond_signal(&conn->reply_ready);
+    pthread_mutex_unlock(&conn->mutex);
+}
+
+//responses of one connection may come from several workers, one line each.
+//they are only queued here, the writer thread sends them.
+void respond(Connection* conn, long id, string body)
+{
+    stringstream ss;
+    ss << "{\"id\": " << id << ", " << body.substr(1) << "\n";
+
+    pthread_mutex_lock(&conn->mutex);
+    conn->replies.push_back(ss.str());
+    pthread_cond_signal(&conn->reply_ready);
+    pthread_mutex_unlock(&conn->mutex);
+}
+
+bool write_all(int fd, const char* p, size_t n)
+{
+    while (n > 0)
+    {
+        ssize_t k = write(fd, p, n);
+        if (k < 0 && errno == EINTR)
+            continue;
+        if (k <= 0)
+            return false;
+        p += k;
+        n -= (size_t)k;
+    }
+    return true;
+}
+
+//write the replies of a connection until its reader is done and every
+//reserved reply is written. after a failed write the replies are dropped.
+void* writer_thread(void* arg)
+{
+    Connection* conn = (Connection*)arg;
+    pthread_mutex_lock(&conn->mutex);
+    while (true)
+    {
+        while (conn->replies.empty() && (conn->reading || conn->pending > 0))
+            pthread_cond_wait(&conn->reply_ready, &conn->mutex);
+        if (conn->replies.empty())
+            break;
+        string line = conn->replies.front();
+        conn->replies.pop_front();
+        bool broken = conn->broken;
+        pthread_mutex_unlock(&conn->mutex);
+
+        if (!broken && !write_all(conn->out_fd, line.c_str(), line.length()))
+            broken = true;
+
+        pthread_mutex_lock(&conn->mutex);
+        conn->broken = conn->broken || broken;
+        conn->pending -= 1;
+        pthread_cond_signal(&conn->reply_room);
+    }
+    pthread_mutex_unlock(&conn->mutex);
+    return NULL;
+}
+
+string error_json(string message)
+{
+    return "{\"status\": \"error\", \"error\": \"" + json_escape(message) + "\"}";
+}
+
+string stats_json(Server* server)
+{
+    pthread_mutex_lock(&server->mutex);
+    long requests = server->requests, completed = server->completed;
+    long solved = server->solved, failed = server->failed, in_flight = server->in_flight;
+    pthread_mutex_unlock(&server->mutex);
+    double uptime = (double)(getTickCount() - server->start) / getTickFrequency();
+
+    stringstream ss;
+    ss << fixed << setprecision(3);
+    ss << "{\"status\": \"stats\""
+       << ", \"requests\": " << requests
+       << ", \"completed\": " << completed
+       << ", \"solved\": " << solved
+       << ", \"failed\": " << failed
+       << ", \"in_flight\": " << in_flight
+       << ", \"queue\": " << server->jobs.get_depth()
+       << ", \"workers\": " << server->workers
+       << ", \"uptime_s\": " << uptime
+       << ", \"throughput_rps\": " << (uptime > 0 ? (double)completed / uptime : 0.0)
+       << ", \"latency_ms\": {\"mean\": " << server->latency.get_mean()
+       << ", \"p50\": " << server->latency.get_percentile(50)
+       << ", \"p95\": " << server->latency.get_percentile(95)
+       << ", \"p99\": " << server->latency.get_percentile(99)
+       << ", \"max\": " << server->latency.get_max() << "}}";
+    return ss.str();
+}
+
+void* server_worker(void* arg)
+{
+    Server* server = (Server*)arg;
+    ServerJob job;
+    while (server->jobs.pop(job))
+    {
+        BatchRecord r;
+        r.filename = job.filename;
+        int64 t0 = getTickCount();
+        string reply;
+        //a bad request must not take the server down
+        try
+        {
+            Mat src_img = job.bytes.empty() ? imread(job.filename) : imdecode(job.bytes, CV_LOAD_IMAGE_COLOR);
+            int64 decoded = getTickCount();
+            Profiler::add(STAGE_DECODE, t0, decoded);
+            r.decode_ms = (double)(decoded - t0) * 1000. / getTickFrequency();
+            server->model.recognize(src_img, r, NULL, 1);
+            r.total_ms = (double)(getTickCount() - t0) * 1000. / getTickFrequency();
+            reply = record_json(r);
+        }
+        catch (cv::Exception& e)
+        {
+            r.status = "error";
+            reply = error_json(e.what());
+        }
+        int64 t1 = getTickCount();
+
+        respond(job.conn, job.id, reply);
+        release_connection(job.conn);
+
+        //latency includes the time spent waiting in the queue
+        server->latency.add((double)(t1 - job.received) * 1000. / getTickFrequency());
+        job = ServerJob();
+        pthread_mutex_lock(&server->mutex);
+        server->completed += 1;
+        if (r.status == "solved")
+            server->solved += 1;
+        else
+            server->failed += 1;
+        server->in_flight -= 1;
+        if (server->in_flight == 0)
+            pthread_cond_broadcast(&server->idle);
+        pthread_mutex_unlock(&server->mutex);
+    }
+    return NULL;
+}
+
+//read requests of one connection until it is closed:
+//  FILE <path>          recognize an image file on this host
+//  IMAGE <n>            followed by n bytes of an encoded image
+//  STATS                latency and throughput of the server
+//  QUIT                 close the connection
+//every request is answered by one json line carrying its id.
+void serve_connection(Connection* conn)
+{
+    Server* server = conn->server;
+    pthread_t writer;
+    pthread_create(&writer, NULL, writer_thread, conn);
+
+    FdReader reader(conn->in_fd);
+    string line;
+    while (reader.read_line(line))
+    {
+        istringstream ss(line);
+        string cmd;
+        ss >> cmd;
+        if (cmd.empty())
+            continue;
+
+        long id = ++conn->next_id;
+        //every request but QUIT gets one reply
+        if (cmd == "QUIT")
+            break;
+        reserve_reply(conn);
+        ServerJob job;
+        if (cmd == "FILE")
+        {
+            getline(ss >> ws, job.filename);
+        }
+        else if (cmd == "IMAGE")
+        {
+            size_t n = 0;
+            ss >> n;
+            if (!ss || n == 0 || n > MAX_IMAGE_BYTES)
+            {
+                //the rest of the stream can not be parsed any more
+                respond(conn, id, error_json("invalid image size"));
+                break;
+            }
+            job.bytes = Mat(1, (int)n, CV_8UC1);
+            if (!reader.read_bytes(job.bytes.data, n))
+            {
+                cancel_reply(conn);
+                break;
+            }
+        }
+        else if (cmd == "STATS")
+        {
+            respond(conn, id, stats_json(server));
+            continue;
+        }
+        else
+        {
+            respond(conn, id, error_json("unknown command " + cmd));
+            continue;
+        }
+
+        job.conn = conn;
+        job.id = id;
+        job.received = getTickCount();
+        acquire_connection(conn);
+        pthread_mutex_lock(&server->mutex);
+        server->requests += 1;
+        server->in_flight += 1;
+        pthread_mutex_unlock(&server->mutex);
+
+        //blocks while the workers are busy, which stops reading from the client
+        if (!server->jobs.wait_push(job))
+        {
+            respond(conn, id, error_json("server is shutting down"));
+            release_connection(conn);
+            pthread_mutex_lock(&server->mutex);
+            server->in_flight -= 1;
+            if (server->in_flight == 0)
+                pthread_cond_broadcast(&server->idle);
+            pthread_mutex_unlock(&server->mutex);
+            break;
+        }
+    }
+
+    pthread_mutex_lock(&conn->mutex);
+    conn->reading = false;
+    pthread_cond_signal(&conn->reply_ready);
+    pthread_mutex_unlock(&conn->mutex);
+    pthread_join(writer, NULL);
+    release_connection(conn);
+}
+
+void* connection_thread(void* arg)
+{
+    Server* server = ((Connection*)arg)->server;
+    serve_connection((Connection*)arg);
+    pthread_mutex_lock(&server->mutex);
+    server->connections -= 1;
+    pthread_cond_broadcast(&server->idle);
+    pthread_mutex_unlock(&server->mutex);
+    return NULL;
+}
+
+int listen_socket(string socket_path)
+{
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (fd < 0 || socket_path.length() >= sizeof(addr.sun_path))
+    {
+        cerr << "Can not create socket " << socket_path << "." << endl;
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    strcpy(addr.sun_path, socket_path.c_str());
+    unlink(socket_path.c_str());
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0)
+    {
+        cerr << "Can not listen on " << socket_path << ": " << strerror(errno) << endl;
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+//accept clients until SIGINT or SIGTERM, then shut the clients down and
+//wait for their threads.
+void accept_clients(Server& server, int fd, sigset_t& wait_mask)
+{
+    while (!stop_requested)
+    {
+        //the stop signals are blocked except while waiting here
+        fd_set ready;
+        FD_ZERO(&ready);
+        FD_SET(fd, &ready);
+        if (pselect(fd + 1, &ready, NULL, NULL, NULL, &wait_mask) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            cerr << "select failed: " << strerror(errno) << endl;
+            break;
+        }
+
+        int client = accept(fd, NULL, NULL);
+        if (client < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            cerr << "accept failed: " << strerror(errno) << endl;
+            break;
+        }
+        pthread_t reader;
+        Connection* conn = open_connection(&server, client, client, true);
+        pthread_mutex_lock(&server.mutex);
+        server.clients.insert(client);
+        server.connections += 1;
+        pthread_mutex_unlock(&server.mutex);
+        if (pthread_create(&reader, NULL, connection_thread, conn) != 0)
+        {
+            pthread_mutex_lock(&server.mutex);
+            server.connections -= 1;
+            pthread_mutex_unlock(&server.mutex);
+            release_connection(conn);
+        }
+        else
+            pthread_detach(reader);
+    }
+
+    pthread_mutex_lock(&server.mutex);
+    for (set<int>::iterator it = server.clients.begin(); it != server.clients.end(); it++)
+        shutdown(*it, SHUT_RDWR);
+    while (server.connections > 0)
+        pthread_cond_wait(&server.idle, &server.mutex);
+    pthread_mutex_unlock(&server.mutex);
+}
+
+//keep the model loaded and answer requests from a unix socket until SIGINT
+//or SIGTERM, or from stdin when socket_path is empty.
+void recognition_server(const SudokuModel& model, string socket_path, int threads)
+{
+    signal(SIGPIPE, SIG_IGN);
+    if (threads <= 0)
+        threads = getNumberOfCPUs();
+
+    //every thread started from here on inherits the blocked stop signals
+    sigset_t stop_signals, wait_mask;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    if (!socket_path.empty())
+    {
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = request_stop;
+        sigaction(SIGINT, &action, NULL);
+        sigaction(SIGTERM, &action, NULL);
+        pthread_sigmask(SIG_BLOCK, &stop_signals, &wait_mask);
+    }
+
+    Server server(model, threads);
+    vector<pthread_t> workers(threads);
+    for (int i = 0; i < threads; i++)
+        pthread_create(&workers[i], NULL, server_worker, &server);
+
+    if (socket_path.empty())
+    {
+        serve_connection(open_connection(&server, STDIN_FILENO, STDOUT_FILENO, false));
+
+        pthread_mutex_lock(&server.mutex);
+        while (server.in_flight > 0)
+            pthread_cond_wait(&server.idle, &server.mutex);
+        pthread_mutex_unlock(&server.mutex);
+    }
+    else
+    {
+        int fd = listen_socket(socket_path);
+        if (fd >= 0)
+        {
+            cerr << "Listening on " << socket_path << " with " << threads << " workers." << endl;
+            accept_clients(server, fd, wait_mask);
+            close(fd);
+            unlink(socket_path.c_str());
+            cerr << "Stopped listening on " << socket_path << "." << endl;
+        }
+    }
+
+    server.jobs.close();
+    for (int i = 0; i < threads; i++)
+        pthread_join(workers[i], NULL);
+}
@@ -0,0 +1,201 @@
+/*
+* This file is part of SudokuEz
+*
+* Copyright (C) 2012-2017 Zhong Xu
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*/
+
+#include <cstring>
+#include <unistd.h>
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include "shard.h"
+
+using namespace std;
+using namespace cv;
+
+const char SHARD_MAGIC[4] = {'S', 'Z', 'C', 'S'};
+const unsigned SHARD_VERSION = 3;
+const long SHARD_HEADER_SIZE = 16;
+const int RECORD_HEADER_SIZE = 12;
+const int MAX_RECORD_SIZE = RECORD_HEADER_SIZE + SHARD_CELL_SIDE * SHARD_CELL_SIDE;
+const size_t SHARD_BUFFER_SIZE = 1 << 20;
+
+
+//64-bit FNV-1a of the pixels
+uint64 hash_pixels(const uchar* p, size_t n)
+{
+    uint64 h = 14695981039346656037ULL;
+    for (size_t i = 0; i < n; i++)
+    {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+CellShard::CellShard()
+{
+    file = NULL;
+    count = 0;
+    end = SHARD_HEADER_SIZE;
+    record.resize(MAX_RECORD_SIZE);
+}
+
+bool CellShard::open(string filename)
+{
+    close();
+
+    unsigned header[4];
+    file = fopen(filename.c_str(), "r+b");
+    if (file == NULL)
+    {
+        file = fopen(filename.c_str(), "w+b");
+        if (file == NULL)
+            return false;
+        memcpy(&header[0], SHARD_MAGIC, 4);
+        header[1] = SHARD_VERSION;
+        header[2] = SHARD_CELL_SIDE;
+        header[3] = 0;
+        fwrite(header, sizeof(header), 1, file);
+    }
+    else if (fread(header, sizeof(header), 1, file) != 1 ||
+             memcmp(&header[0], SHARD_MAGIC, 4) != 0 ||
+             header[1] != SHARD_VERSION || header[2] != (unsigned)SHARD_CELL_SIDE)
+    {
+        close();
+        return false;
+    }
+    setvbuf(file, NULL, _IOFBF, SHARD_BUFFER_SIZE);
+
+    //one pass over the record headers to index the cells and learn their
+    //hashes, skipping the pixels
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    end = SHARD_HEADER_SIZE;
+    fseek(file, end, SEEK_SET);
+    while (end + RECORD_HEADER_SIZE <= size && fread(&record[0], RECORD_HEADER_SIZE, 1, file) == 1)
+    {
+        long next = end + RECORD_HEADER_SIZE + (long)record[9] * (long)record[10];
+        if (record[9] == 0 || record[10] == 0 || next > size)
+            break;
+        uint64 h;
+        memcpy(&h, &record[0], sizeof(h));
+        hashes.insert(h);
+        offsets.push_back(end);
+        end = next;
+        fseek(file, end, SEEK_SET);
+    }
+    count = (int)offsets.size();
+    //a record cut short by an interrupted append is dropped
+    if (end < size)
+    {
+        fflush(file);
+        if (ftruncate(fileno(file), end) != 0)
+        {
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void CellShard::close()
+{
+    if (file != NULL)
+        fclose(file);
+    file = NULL;
+    count = 0;
+    offsets.clear();
+    end = SHARD_HEADER_SIZE;
+    hashes.clear();
+}
+
+Mat CellShard::normalize(Mat img)
+{
+    Mat gray, cell;
+    if (img.channels() == 1)
+        gray = img;
+    else
+        cvtColor(img, gray, CV_BGR2GRAY);
+    int side = MAX(gray.cols, gray.rows);
+    if (side <= SHARD_CELL_SIDE)
+        return gray.clone();
+    resize(gray, cell, Size(MAX(gray.cols * SHARD_CELL_SIDE / side, 1),
+                            MAX(gray.rows * SHARD_CELL_SIDE / side, 1)), 0, 0, INTER_AREA);
+    return cell;
+}
+
+bool CellShard::append(Mat cell, int label)
+{
+    if (file == NULL)
+        return false;
+    if (cell.empty() || cell.cols > SHARD_CELL_SIDE || cell.rows > SHARD_CELL_SIDE)
+        return false;
+
+    //the size and the pixels are hashed, the label is not
+    int size = RECORD_HEADER_SIZE + cell.cols * cell.rows;
+    memset(&record[0], 0, RECORD_HEADER_SIZE);
+    record[9] = (uchar)cell.cols;
+    record[10] = (uchar)cell.rows;
+    for (int y = 0; y < cell.rows; y++)
+        memcpy(&record[RECORD_HEADER_SIZE + y * cell.cols], cell.ptr<uchar>(y), cell.cols);
+    uint64 h = hash_pixels(&record[9], size - 9);
+    if (hashes.count(h) > 0)
+        return false;
+    memcpy(&record[0], &h, sizeof(h));
+    record[8] = (uchar)(schar)label;
+
+    fseek(file, end, SEEK_SET);
+    if (fwrite(&record[0], size, 1, file) != 1)
+        return false;
+    hashes.insert(h);
+    offsets.push_back(end);
+    end += size;
+    count += 1;
+    return true;
+}
+
+bool CellShard::read(int i, Mat& cell, int& label)
+{
+    if (file == NULL || i < 0 || i >= count)
+        return false;
+    fseek(file, offsets[i], SEEK_SET);
+    if (fread(&record[0], RECORD_HEADER_SIZE, 1, file) != 1)
+        return false;
+    label = (schar)record[8];
+    int width = record[9], height = record[10];
+    if (width == 0 || height == 0)
+        return false;
+    cell.create(height, width, CV_8UC1);
+    return fread(cell.data, cell.total(), 1, file) == 1;
+}
+
+bool CellShard::set_label(int i, int label)
+{
+    if (file == NULL || i < 0 || i >= count)
+        return false;
+    uchar b = (uchar)(schar)label;
+    fseek(file, offsets[i] + 8, SEEK_SET);
+    bool result = fwrite(&b, 1, 1, file) == 1;
+    fflush(file);
+    return result;
+}
@@ -0,0 +1,89 @@
+/*
+* This file is part of SudokuEz
+*
+* Copyright (C) 2012-2017 Zhong Xu
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*/
+
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <cstdio>
+#include <set>
+#include <string>
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+using namespace std;
+using namespace cv;
+
+//largest side of the gray cells kept in a shard. the cells of an image of
+//RESIZED_IMG_ROWS rows are smaller, and are stored at their own size.
+const int SHARD_CELL_SIDE = 128;
+const int UNLABELED = -1;
+
+//many cell images packed in one file. after a 16 byte header come the
+//records one after the other, each as long as its cell:
+//    8 bytes  hash of the size and the pixels
+//    1 byte   label, 0-9 or -1 when unlabeled
+//    1 byte   width
+//    1 byte   height
+//    1 byte   reserved
+//    width x height gray pixels, row after row
+//open() reads the record headers once to index where every cell starts.
+class CellShard
+{
+    public:
+
+    CellShard();
+    ~CellShard() {close();}
+
+    //open a shard for reading and appending, creating it when missing.
+    bool open(string filename);
+    void close();
+
+    //append a normalized cell unless the same pixels are already stored.
+    //returns false for duplicates.
+    bool append(Mat cell, int label = UNLABELED);
+
+    int get_count() {return count;}
+    bool read(int i, Mat& cell, int& label);
+    bool set_label(int i, int label);
+
+    //gray cell of any cropped cell, at the size recognition reads it at.
+    //only cells larger than SHARD_CELL_SIDE are scaled down.
+    static Mat normalize(Mat img);
+
+    private:
+
+    CellShard(const CellShard&);
+    CellShard& operator=(const CellShard&);
+
+    FILE* file;
+    int count;
+    //where every record starts, and where the next one is appended
+    vector<long> offsets;
+    long end;
+    set<uint64> hashes;
+    vector<uchar> record;
+};
+
+#endif
@@ -23,6 +23,9 @@
 *
 */
 
+#include <cstddef>
+#include "solve.h"
+
 bool h_test(int result[], int n, int i)
 {
     int y = n / 9;
@@ -99,3 +102,312 @@ bool go(int data[], int n, int result[])
     }
     return false;
 }
+
+//bitmask solver. bit d - 1 of a mask stands for digit d, and the masks of
+//rows, columns and boxes hold the digits already placed in them.
+const int ALL_DIGITS = 0x1ff;
+
+int box_of(int n)
+{
+    return n / 27 * 3 + n % 9 / 3;
+}
+
+//cell k of unit u: units 0-8 are rows, 9-17 columns and 18-26 boxes.
+int unit_cell(int u, int k)
+{
+    if (u < 9)
+        return u * 9 + k;
+    if (u < 18)
+        return k * 9 + u - 9;
+    int b = u - 18;
+    return (b / 3 * 3 + k / 3) * 9 + b % 3 * 3 + k % 3;
+}
+
+struct Masks
+{
+    int rows[9];
+    int cols[9];
+    int boxes[9];
+
+    int allowed(int n) {return ALL_DIGITS & ~(rows[n / 9] | cols[n % 9] | boxes[box_of(n)]);}
+    void flip(int n, int bit) {rows[n / 9] ^= bit; cols[n % 9] ^= bit; boxes[box_of(n)] ^= bit;}
+};
+
+//returns false when the givens already conflict.
+bool init_masks(int grid[], Masks& m)
+{
+    for (int i = 0; i < 9; i++)
+        m.rows[i] = m.cols[i] = m.boxes[i] = 0;
+    for (int n = 0; n < 81; n++)
+    {
+        if (grid[n] == 0)
+            continue;
+        int bit = 1 << (grid[n] - 1);
+        if ((m.allowed(n) & bit) == 0)
+            return false;
+        m.flip(n, bit);
+    }
+    return true;
+}
+
+//the empty cell with the fewest candidates, -1 when the grid is full.
+int most_constrained(int grid[], Masks& m, int& candidates)
+{
+    int best = -1, best_count = 10;
+    candidates = 0;
+    for (int n = 0; n < 81 && best_count > 1; n++)
+    {
+        if (grid[n] != 0)
+            continue;
+        int c = m.allowed(n);
+        int count = __builtin_popcount(c);
+        if (count < best_count)
+        {
+            best = n;
+            best_count = count;
+            candidates = c;
+        }
+    }
+    return best;
+}
+
+int count_from(int grid[], Masks& m, int limit, int result[])
+{
+    int candidates;
+    int n = most_constrained(grid, m, candidates);
+    if (n < 0)
+    {
+        if (result != NULL)
+            for (int i = 0; i < 81; i++)
+                result[i] = grid[i];
+        return 1;
+    }
+
+    int count = 0;
+    while (candidates != 0 && count < limit)
+    {
+        int bit = candidates & -candidates;
+        candidates ^= bit;
+        grid[n] = __builtin_ctz(bit) + 1;
+        m.flip(n, bit);
+        count += count_from(grid, m, limit - count, count == 0 ? result : NULL);
+        m.flip(n, bit);
+    }
+    grid[n] = 0;
+    return count;
+}
+
+//number of solutions of data, counting stops at limit. result, when not
+//NULL, gets the first solution found.
+int count_solutions(int data[], int limit, int result[])
+{
+    int grid[81];
+    for (int i = 0; i < 81; i++)
+        grid[i] = data[i];
+    Masks m;
+    if (!init_masks(grid, m))
+        return 0;
+    return count_from(grid, m, limit, result);
+}
+
+//depth-first search that counts the values tried in cells with more than
+//one candidate until the first solution.
+bool guess_from(int grid[], Masks& m, int& guesses)
+{
+    int candidates;
+    int n = most_constrained(grid, m, candidates);
+    if (n < 0)
+        return true;
+
+    bool branching = __builtin_popcount(candidates) > 1;
+    while (candidates != 0)
+    {
+        int bit = candidates & -candidates;
+        candidates ^= bit;
+        if (branching)
+            guesses += 1;
+        grid[n] = __builtin_ctz(bit) + 1;
+        m.flip(n, bit);
+        bool solved = guess_from(grid, m, guesses);
+        m.flip(n, bit);
+        if (solved)
+            return true;
+    }
+    grid[n] = 0;
+    return false;
+}
+
+struct Candidates
+{
+    int grid[81];
+    int cand[81];
+
+    void place(int n, int d)
+    {
+        grid[n] = d;
+        cand[n] = 0;
+        int units[3] = {n / 9, 9 + n % 9, 18 + box_of(n)};
+        for (int u = 0; u < 3; u++)
+            for (int k = 0; k < 9; k++)
+                cand[unit_cell(units[u], k)] &= ~(1 << (d - 1));
+    }
+
+    //remove bits from the cells of unit u that are not in keep.
+    bool eliminate(int u, int bits, int keep[], int keep_count)
+    {
+        bool changed = false;
+        for (int k = 0; k < 9; k++)
+        {
+            int n = unit_cell(u, k);
+            bool kept = false;
+            for (int j = 0; j < keep_count; j++)
+                kept = kept || keep[j] == n;
+            if (!kept && (cand[n] & bits) != 0)
+            {
+                cand[n] &= ~bits;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+};
+
+bool naked_singles(Candidates& c)
+{
+    bool progress = false;
+    for (int n = 0; n < 81; n++)
+    {
+        if (c.grid[n] == 0 && __builtin_popcount(c.cand[n]) == 1)
+        {
+            c.place(n, __builtin_ctz(c.cand[n]) + 1);
+            progress = true;
+        }
+    }
+    return progress;
+}
+
+bool hidden_singles(Candidates& c)
+{
+    bool progress = false;
+    for (int u = 0; u < 27; u++)
+    {
+        for (int d = 1; d <= 9; d++)
+        {
+            int count = 0, last = -1;
+            for (int k = 0; k < 9; k++)
+            {
+                int n = unit_cell(u, k);
+                if ((c.cand[n] & (1 << (d - 1))) != 0)
+                {
+                    count += 1;
+                    last = n;
+                }
+            }
+            if (count == 1)
+            {
+                c.place(last, d);
+                progress = true;
+            }
+        }
+    }
+    return progress;
+}
+
+//a digit confined to one line of a box, or to one box of a line, can be
+//removed from the rest of the other unit. two cells of a unit with the
+//same two candidates remove them from the rest of the unit.
+bool locked_candidates_and_pairs(Candidates& c)
+{
+    bool progress = false;
+    for (int u = 0; u < 27; u++)
+    {
+        for (int d = 1; d <= 9; d++)
+        {
+            int bit = 1 << (d - 1);
+            int cells[9], count = 0;
+            for (int k = 0; k < 9; k++)
+            {
+                int n = unit_cell(u, k);
+                if ((c.cand[n] & bit) != 0)
+                    cells[count++] = n;
+            }
+            if (count < 2)
+                continue;
+
+            bool same_row = true, same_col = true, same_box = true;
+            for (int j = 1; j < count; j++)
+            {
+                same_row = same_row && cells[j] / 9 == cells[0] / 9;
+                same_col = same_col && cells[j] % 9 == cells[0] % 9;
+                same_box = same_box && box_of(cells[j]) == box_of(cells[0]);
+            }
+            if (u >= 18 && same_row)
+                progress = c.eliminate(cells[0] / 9, bit, cells, count) || progress;
+            if (u >= 18 && same_col)
+                progress = c.eliminate(9 + cells[0] % 9, bit, cells, count) || progress;
+            if (u < 18 && same_box)
+                progress = c.eliminate(18 + box_of(cells[0]), bit, cells, count) || progress;
+        }
+
+        for (int a = 0; a < 9; a++)
+        {
+            int na = unit_cell(u, a);
+            if (__builtin_popcount(c.cand[na]) != 2)
+                continue;
+            for (int b = a + 1; b < 9; b++)
+            {
+                int nb = unit_cell(u, b);
+                if (c.cand[nb] == c.cand[na])
+                {
+                    int pair[2] = {na, nb};
+                    progress = c.eliminate(u, c.cand[na], pair, 2) || progress;
+                }
+            }
+        }
+    }
+    return progress;
+}
+
+//grade data by the hardest technique a human needs, always trying the
+//simplest one first. guesses counts the values tried by a depth-first
+//search once the techniques are stuck, 0 when they solve it.
+int grade_puzzle(int data[], int& guesses)
+{
+    guesses = 0;
+    Masks m;
+    Candidates c;
+    for (int n = 0; n < 81; n++)
+        c.grid[n] = data[n];
+    if (!init_masks(c.grid, m))
+        return GRADE_INVALID;
+    for (int n = 0; n < 81; n++)
+        c.cand[n] = c.grid[n] == 0 ? m.allowed(n) : 0;
+
+    int grade = GRADE_EASY;
+    while (true)
+    {
+        if (naked_singles(c))
+            continue;
+        if (hidden_singles(c))
+        {
+            grade = grade > GRADE_MEDIUM ? grade : GRADE_MEDIUM;
+            continue;
+        }
+        if (locked_candidates_and_pairs(c))
+        {
+            grade = GRADE_HARD;
+            continue;
+        }
+        break;
+    }
+
+    bool solved = true;
+    for (int n = 0; n < 81; n++)
+        solved = solved && c.grid[n] != 0;
+    if (solved)
+        return grade;
+
+    if (!init_masks(c.grid, m) || !guess_from(c.grid, m, guesses))
+        return GRADE_INVALID;
+    return GRADE_EXPERT;
+}
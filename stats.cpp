@@ -0,0 +1,97 @@
+/*
+* This file is part of SudokuEz
+*
+* Copyright (C) 2012-2017 Zhong Xu
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*/
+
+#include <algorithm>
+#include "stats.h"
+
+using namespace std;
+
+
+LatencyStats::LatencyStats(size_t capacity)
+{
+    this->capacity = capacity;
+    count = 0;
+    sum = 0.0;
+    max = 0.0;
+    pthread_mutex_init(&mutex, NULL);
+}
+
+LatencyStats::~LatencyStats()
+{
+    pthread_mutex_destroy(&mutex);
+}
+
+void LatencyStats::add(double ms)
+{
+    pthread_mutex_lock(&mutex);
+    if (samples.size() < capacity)
+        samples.push_back(ms);
+    else
+        samples[count % capacity] = ms;
+    count += 1;
+    sum += ms;
+    if (ms > max)
+        max = ms;
+    pthread_mutex_unlock(&mutex);
+}
+
+long LatencyStats::get_count()
+{
+    pthread_mutex_lock(&mutex);
+    long result = count;
+    pthread_mutex_unlock(&mutex);
+    return result;
+}
+
+double LatencyStats::get_mean()
+{
+    pthread_mutex_lock(&mutex);
+    double result = count > 0 ? sum / (double)count : 0.0;
+    pthread_mutex_unlock(&mutex);
+    return result;
+}
+
+double LatencyStats::get_max()
+{
+    pthread_mutex_lock(&mutex);
+    double result = max;
+    pthread_mutex_unlock(&mutex);
+    return result;
+}
+
+double LatencyStats::get_percentile(double p)
+{
+    pthread_mutex_lock(&mutex);
+    vector<double> sorted = samples;
+    pthread_mutex_unlock(&mutex);
+
+    if (sorted.empty())
+        return 0.0;
+    sort(sorted.begin(), sorted.end());
+    size_t i = (size_t)(p / 100. * (double)(sorted.size() - 1) + .5);
+    if (i >= sorted.size())
+        i = sorted.size() - 1;
+    return sorted[i];
+}
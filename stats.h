@@ -0,0 +1,64 @@
+/*
+* This file is part of SudokuEz
+*
+* Copyright (C) 2012-2017 Zhong Xu
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*/
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <vector>
+#include <pthread.h>
+
+using namespace std;
+
+//thread-safe latency record. the last few thousand samples are kept for percentiles.
+class LatencyStats
+{
+    public:
+
+    LatencyStats(size_t capacity = 10000);
+    ~LatencyStats();
+
+    void add(double ms);
+
+    long get_count();
+    double get_mean();
+    double get_max();
+    //p in [0, 100], over the kept samples.
+    double get_percentile(double p);
+
+    private:
+
+    LatencyStats(const LatencyStats&);
+    LatencyStats& operator=(const LatencyStats&);
+
+    vector<double> samples;
+    size_t capacity;
+    long count;
+    double sum;
+    double max;
+
+    pthread_mutex_t mutex;
+};
+
+#endif
@@ -0,0 +1,224 @@
+/*
+* This file is part of SudokuEz
+*
+* Copyright (C) 2012-2017 Zhong Xu
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*/
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <ml.h>
+#include "sudokuez.h"
+#include "parallel.h"
+#include "profiler.h"
+
+using namespace std;
+using namespace cv;
+
+
+double elapsed_ms(int64 from, int64 to)
+{
+    return (double)(to - from) * 1000. / getTickFrequency();
+}
+
+SudokuModel::SudokuModel()
+{
+    engine = ENGINE_CONTOUR;
+    loaded = false;
+}
+
+bool SudokuModel::load(string svm_filename, DetectionEngine engine)
+{
+    svm.load(svm_filename.c_str());
+    this->engine = engine;
+    loaded = svm.get_var_count() == FEATURE_SIZE;
+    return loaded;
+}
+
+bool SudokuModel::solve(int data[], int result[]) const
+{
+    StageTimer timer(STAGE_SOLVE);
+    for (int i = 0; i < 81; i++)
+        result[i] = data[i];
+    return go(data, 0, result);
+}
+
+struct GridsJob
+{
+    const SudokuModel* model;
+    GrayFrame* frame;
+    vector<Grid>* grids;
+    //per grid, so that the threads do not share them
+    vector<double> recognize_ms;
+    vector<double> solve_ms;
+    //grids whose recognition threw, an exception can not leave a thread
+    vector<char> failed;
+};
+
+void recognize_grid_task(int i, void* arg)
+{
+    GridsJob* job = (GridsJob*)arg;
+    Grid& grid = (*job->grids)[i];
+    try
+    {
+        int64 t0 = getTickCount();
+        recognize_digits(*job->frame, grid.rects, job->model->get_svm(), grid.data);
+        int64 t1 = getTickCount();
+        grid.succeed = job->model->solve(grid.data, grid.result);
+        int64 t2 = getTickCount();
+        job->recognize_ms[i] = elapsed_ms(t0, t1);
+        job->solve_ms[i] = elapsed_ms(t1, t2);
+    }
+    catch (cv::Exception& e)
+    {
+        grid.succeed = false;
+        job->failed[i] = 1;
+    }
+}
+
+void solve_grid_task(int i, void* arg)
+{
+    GridsJob* job = (GridsJob*)arg;
+    Grid& grid = (*job->grids)[i];
+    grid.succeed = job->model->solve(grid.data, grid.result);
+}
+
+void SudokuModel::recognize(Mat src_img, Recognition& r, Mat* annotated, int threads) const
+{
+    try
+    {
+        recognize_image(src_img, r, annotated, threads);
+    }
+    catch (cv::Exception& e)
+    {
+        //an image opencv can not process fails alone, not the whole run
+        r.grids.clear();
+        r.status = "error";
+    }
+}
+
+void SudokuModel::recognize_image(Mat src_img, Recognition& r, Mat* annotated, int threads) const
+{
+    r.grids.clear();
+    r.detect_ms = r.recognize_ms = r.solve_ms = 0;
+    if (src_img.empty())
+    {
+        r.status = "unreadable";
+        return;
+    }
+
+    //a strip too narrow to keep a column once resized can not hold a grid
+    int cols = src_img.cols * RESIZED_IMG_ROWS / src_img.rows;
+    if (cols == 0)
+    {
+        r.status = "no_grid";
+        return;
+    }
+
+    int64 t0 = getTickCount();
+    Mat img;
+    resize(src_img, img, Size(cols, RESIZED_IMG_ROWS));
+    Profiler::add(STAGE_RESIZE, t0, getTickCount());
+
+    GrayFrame frame;
+    prepare_frame(img, frame);
+    vector<Box> detected_boxes;
+    get_grids(frame, engine, r.grids, detected_boxes, 0);
+    r.detect_ms = elapsed_ms(t0, getTickCount());
+
+    if (r.grids.empty())
+    {
+        r.status = "no_grid";
+        return;
+    }
+
+    GridsJob job;
+    job.model = this;
+    job.frame = &frame;
+    job.grids = &r.grids;
+    job.recognize_ms.resize(r.grids.size());
+    job.solve_ms.resize(r.grids.size());
+    job.failed.resize(r.grids.size(), 0);
+    run_parallel((int)r.grids.size(), threads, recognize_grid_task, &job);
+    for (size_t i = 0; i < r.grids.size(); i++)
+        if (job.failed[i])
+        {
+            r.grids.clear();
+            r.status = "error";
+            return;
+        }
+
+    r.status = "solved";
+    for (size_t i = 0; i < r.grids.size(); i++)
+    {
+        r.recognize_ms += job.recognize_ms[i];
+        r.solve_ms += job.solve_ms[i];
+        if (!r.grids[i].succeed)
+            r.status = "unsolvable";
+    }
+
+    if (annotated != NULL)
+    {
+        for (size_t i = 0; i < r.grids.size(); i++)
+            draw_solution(img, r.grids[i].data, r.grids[i].result, r.grids[i].rects);
+        *annotated = img;
+    }
+
+    double scale = (double)src_img.rows / (double)img.rows;
+    for (size_t i = 0; i < r.grids.size(); i++)
+        for (int k = 0; k < 4; k++)
+            r.grids[i].corners[k] = Point(cvRound(r.grids[i].corners[k].x * scale),
+                                          cvRound(r.grids[i].corners[k].y * scale));
+}
+
+struct ImagesJob
+{
+    const SudokuModel* model;
+    vector<Mat>* images;
+    vector<Recognition>* results;
+};
+
+void recognize_image_task(int i, void* arg)
+{
+    ImagesJob* job = (ImagesJob*)arg;
+    //the images are already spread over the threads, so the grids of one
+    //image are done in turn.
+    job->model->recognize((*job->images)[i], (*job->results)[i], NULL, 1);
+}
+
+void SudokuModel::recognize(vector<Mat>& images, vector<Recognition>& results, int threads) const
+{
+    ImagesJob job;
+    job.model = this;
+    job.images = &images;
+    job.results = &results;
+    results.resize(images.size());
+    run_parallel((int)images.size(), threads, recognize_image_task, &job);
+}
+
+void SudokuModel::solve(vector<Grid>& grids, int threads) const
+{
+    GridsJob job;
+    job.model = this;
+    job.frame = NULL;
+    job.grids = &grids;
+    run_parallel((int)grids.size(), threads, solve_grid_task, &job);
+}
@@ -0,0 +1,125 @@
+/*
+* This file is part of SudokuEz
+*
+* Copyright (C) 2012-2017 Zhong Xu
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*/
+
+#ifndef SUDOKUEZ_H
+#define SUDOKUEZ_H
+
+#include <string>
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include <ml.h>
+#include "box.h"
+#include "frame.h"
+#include "grid.h"
+#include "solve.h"
+
+using namespace std;
+using namespace cv;
+
+//public interface of libsudokuez. a SudokuModel is loaded once, then any
+//number of threads recognize and solve images with it. the steps it is
+//made of are declared below for the clients that drive them one by one,
+//like the camera pipeline and the benchmark.
+
+//length of the feature vector of one cell
+const int FEATURE_SIZE = 80;
+//images are resized to this many rows before detection
+const int RESIZED_IMG_ROWS = 1000;
+
+//detection, in processing.cpp and hough.cpp. max_grids <= 0 finds all of
+//them.
+int get_grids(GrayFrame& frame, DetectionEngine engine, vector<Grid>& grids,
+              vector<Box>& detected_boxes, int max_grids);
+bool get_cropped_imgs(GrayFrame& frame, DetectionEngine engine, Mat cropped_imgs[],
+                      Rect rects[], vector<Box>& detected_boxes);
+bool get_hough_grid(GrayFrame& frame, Grid& grid);
+
+//recognition, in feature.cpp and recognition.cpp
+bool extract_feature(GrayFrame& frame, Rect cell, float feature[], Mat& processed_img);
+bool extract_feature(Mat img, float feature[], Mat& processed_img);
+int recognize_cell(GrayFrame& frame, Rect rect, const CvSVM& svm);
+void recognize_digits(GrayFrame& frame, Rect rects[], const CvSVM& svm, int data[]);
+bool get_solution(GrayFrame& frame, Rect rects[], const CvSVM& svm, int data[], int result[]);
+
+void draw_solution(Mat& img, int data[], int result[], Rect rects[]);
+void draw_detected_boxes(Mat& img, vector<Box>& detected_boxes);
+
+//milliseconds between two getTickCount()
+double elapsed_ms(int64 from, int64 to);
+
+//outcome of recognizing one image: status is one of solved (every grid
+//found is solved), unsolvable, no_grid, unreadable or error (opencv threw
+//on the image, which then has no grid).
+struct Recognition
+{
+    string status;
+    //in reading order. corners are in the coordinates of the source image,
+    //rects in those of the image resized to RESIZED_IMG_ROWS.
+    vector<Grid> grids;
+    double detect_ms, recognize_ms, solve_ms;
+};
+
+//a trained svm and the detection engine. load() is the only method that
+//changes it: the others are const and can be called from many threads at
+//once, the svm is only read by predict(). the one state shared by the
+//whole process is the Profiler, which is off unless enabled.
+class SudokuModel
+{
+    public:
+
+    SudokuModel();
+
+    bool load(string svm_filename, DetectionEngine engine);
+    bool is_loaded() const {return loaded;}
+
+    DetectionEngine get_engine() const {return engine;}
+    const CvSVM& get_svm() const {return svm;}
+
+    //recognize and solve every grid of src_img, the grids on up to threads
+    //threads (one per cpu when threads <= 0). annotated gets the solutions
+    //drawn on the resized image when it is not NULL. it does not throw.
+    void recognize(Mat src_img, Recognition& r, Mat* annotated, int threads) const;
+    //recognize many images, each on one of threads threads.
+    void recognize(vector<Mat>& images, vector<Recognition>& results, int threads) const;
+
+    //solve data into result, false when it has no solution.
+    bool solve(int data[], int result[]) const;
+    //solve the data of every grid into its result and succeed.
+    void solve(vector<Grid>& grids, int threads) const;
+
+    private:
+
+    SudokuModel(const SudokuModel&);
+    SudokuModel& operator=(const SudokuModel&);
+
+    //recognize() without catching the exceptions of opencv.
+    void recognize_image(Mat src_img, Recognition& r, Mat* annotated, int threads) const;
+
+    CvSVM svm;
+    DetectionEngine engine;
+    bool loaded;
+};
+
+#endif
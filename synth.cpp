@@ -0,0 +1,273 @@
+/*
+* This file is part of SudokuEz
+*
+* Copyright (C) 2012-2017 Zhong Xu
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*/
+
+//#define SUDOKU_DEBUG
+
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <sys/stat.h>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include "parallel.h"
+#include "solve.h"
+#include "modes.h"
+
+using namespace std;
+using namespace cv;
+
+const int SYNTH_CELL = 48;
+const int SYNTH_MARGIN = 4;
+const double MIN_GIVEN_RATIO = .3;
+const double MAX_GIVEN_RATIO = .5;
+
+
+//random valid solution: a pattern grid shuffled by the transformations
+//that keep rows, columns and boxes valid.
+void random_solution(RNG& rng, int result[])
+{
+    int digits[9], rows[9], cols[9];
+    for (int i = 0; i < 9; i++)
+        digits[i] = rows[i] = cols[i] = i;
+    for (int i = 8; i > 0; i--)
+        swap(digits[i], digits[rng.uniform(0, i + 1)]);
+    //rows may move inside their band and bands may move, the same for columns
+    int bands[3] = {0, 1, 2}, stacks[3] = {0, 1, 2};
+    for (int i = 2; i > 0; i--)
+    {
+        swap(bands[i], bands[rng.uniform(0, i + 1)]);
+        swap(stacks[i], stacks[rng.uniform(0, i + 1)]);
+    }
+    for (int b = 0; b < 3; b++)
+    {
+        for (int i = 2; i > 0; i--)
+        {
+            swap(rows[b * 3 + i], rows[b * 3 + rng.uniform(0, i + 1)]);
+            swap(cols[b * 3 + i], cols[b * 3 + rng.uniform(0, i + 1)]);
+        }
+    }
+    bool transpose = rng.uniform(0, 2) == 1;
+
+    for (int y = 0; y < 9; y++)
+    {
+        for (int x = 0; x < 9; x++)
+        {
+            int r = bands[y / 3] * 3 + rows[y] % 3;
+            int c = stacks[x / 3] * 3 + cols[x] % 3;
+            if (transpose)
+                swap(r, c);
+            result[y * 9 + x] = digits[(r * 3 + r / 3 + c) % 9] + 1;
+        }
+    }
+}
+
+//grid lines and the given digits on a square of 9 cells.
+Mat render_grid(RNG& rng, int data[])
+{
+    int side = SYNTH_CELL * 9 + 2 * SYNTH_MARGIN;
+    double paper = rng.uniform(200., 255.);
+    Mat grid(side, side, CV_8UC3, Scalar(paper, paper - rng.uniform(0., 20.), paper - rng.uniform(0., 30.)));
+    Scalar ink = Scalar::all(rng.uniform(0., 60.));
+
+    int thin = rng.uniform(1, 3), thick = thin + rng.uniform(1, 4);
+    for (int i = 0; i <= 9; i++)
+    {
+        int p = SYNTH_MARGIN + i * SYNTH_CELL;
+        int th = i % 3 == 0 ? thick : thin;
+        line(grid, Point(p, SYNTH_MARGIN), Point(p, side - SYNTH_MARGIN), ink, th);
+        line(grid, Point(SYNTH_MARGIN, p), Point(side - SYNTH_MARGIN, p), ink, th);
+    }
+
+    const int fonts[] = {FONT_HERSHEY_SIMPLEX, FONT_HERSHEY_DUPLEX, FONT_HERSHEY_COMPLEX};
+    int font = fonts[rng.uniform(0, 3)];
+    double scale = rng.uniform(1.1, 1.5);
+    int weight = rng.uniform(2, 4);
+    for (int i = 0; i < 81; i++)
+    {
+        if (data[i] == 0)
+            continue;
+        stringstream ss;
+        ss << data[i];
+        int baseline;
+        Size size = getTextSize(ss.str(), font, scale, weight, &baseline);
+        Point org(SYNTH_MARGIN + (i % 9) * SYNTH_CELL + (SYNTH_CELL - size.width) / 2,
+                  SYNTH_MARGIN + (i / 9) * SYNTH_CELL + (SYNTH_CELL + size.height) / 2);
+        putText(grid, ss.str(), org, font, scale, ink, weight, CV_AA);
+    }
+    return grid;
+}
+
+//place the grid on a page with perspective, rotation, lighting, blur,
+//noise and a random resolution. corners get the grid's outer corners.
+Mat render_page(RNG& rng, Mat grid, Point2f corners[])
+{
+    int rows = rng.uniform(480, 1200);
+    int cols = rows * rng.uniform(3, 5) / 3;
+    double paper = rng.uniform(120., 230.);
+    Mat page(rows, cols, CV_8UC3, Scalar::all(paper));
+
+    //the grid fills 40% to 90% of the page height
+    float side = (float)(rows * rng.uniform(.4, .9));
+    Point2f center((float)cols / 2 + (float)rng.uniform(-.1, .1) * (float)cols,
+                   (float)rows / 2 + (float)rng.uniform(-.05, .05) * (float)rows);
+    double angle = rng.uniform(-15., 15.) * CV_PI / 180;
+    float jitter = side * .08f;
+    float g = (float)grid.rows;
+    Point2f src[4] = {Point2f(0, 0), Point2f(g, 0), Point2f(g, g), Point2f(0, g)};
+    Point2f dst[4];
+    for (int i = 0; i < 4; i++)
+    {
+        float x = (src[i].x / g - .5f) * side, y = (src[i].y / g - .5f) * side;
+        dst[i] = Point2f(center.x + (float)(x * cos(angle) - y * sin(angle)) + (float)rng.uniform(-jitter, jitter),
+                         center.y + (float)(x * sin(angle) + y * cos(angle)) + (float)rng.uniform(-jitter, jitter));
+    }
+    Mat m = getPerspectiveTransform(src, dst);
+    warpPerspective(grid, page, m, page.size(), INTER_LINEAR, BORDER_TRANSPARENT);
+
+    //the grid's lines are SYNTH_MARGIN inside the rendered square
+    Point2f inner[4] = {Point2f(SYNTH_MARGIN, SYNTH_MARGIN), Point2f(g - SYNTH_MARGIN, SYNTH_MARGIN),
+                        Point2f(g - SYNTH_MARGIN, g - SYNTH_MARGIN), Point2f(SYNTH_MARGIN, g - SYNTH_MARGIN)};
+    vector<Point2f> inner_v(inner, inner + 4), corners_v;
+    perspectiveTransform(inner_v, corners_v, m);
+    for (int i = 0; i < 4; i++)
+        corners[i] = corners_v[i];
+
+    //lighting falls off linearly in a random direction
+    double strength = rng.uniform(0., .5), direction = rng.uniform(0., 2 * CV_PI);
+    double dx = cos(direction) / cols, dy = sin(direction) / rows;
+    Mat gradient(rows, cols, CV_32FC1);
+    for (int y = 0; y < rows; y++)
+    {
+        float* p = gradient.ptr<float>(y);
+        for (int x = 0; x < cols; x++)
+            p[x] = (float)(1 - strength * ((x - cols / 2) * dx + (y - rows / 2) * dy + .5));
+    }
+    vector<Mat> channels;
+    split(page, channels);
+    for (size_t c = 0; c < channels.size(); c++)
+    {
+        Mat f;
+        channels[c].convertTo(f, CV_32F);
+        multiply(f, gradient, f);
+        f.convertTo(channels[c], CV_8U);
+    }
+    merge(channels, page);
+
+    double sigma = rng.uniform(0., 2.);
+    if (sigma > .3)
+        GaussianBlur(page, page, Size(0, 0), sigma);
+
+    Mat noise(page.size(), CV_16SC3);
+    randn(noise, Scalar::all(0), Scalar::all(rng.uniform(0., 12.)));
+    add(page, noise, page, Mat(), CV_8U);
+
+    return page;
+}
+
+struct SynthJob
+{
+    string directory;
+    uint64 seed;
+    vector<string> truth;
+};
+
+void synth_task(int i, void* arg)
+{
+    SynthJob* job = (SynthJob*)arg;
+    RNG rng(task_seed(job->seed, i));
+
+    int data[81], result[81];
+    random_solution(rng, result);
+    //givens are removed in random order only while the solution stays
+    //unique, so that the solution of truth.txt is the only one
+    int givens = 81, target = cvRound(81 * rng.uniform(MIN_GIVEN_RATIO, MAX_GIVEN_RATIO));
+    int order[81];
+    for (int j = 0; j < 81; j++)
+    {
+        data[j] = result[j];
+        order[j] = j;
+    }
+    for (int j = 80; j > 0; j--)
+        swap(order[j], order[rng.uniform(0, j + 1)]);
+    for (int j = 0; j < 81 && givens > target; j++)
+    {
+        int n = order[j];
+        data[n] = 0;
+        if (count_solutions(data, 2, NULL) == 1)
+            givens -= 1;
+        else
+            data[n] = result[n];
+    }
+
+    Point2f corners[4];
+    Mat page = render_page(rng, render_grid(rng, data), corners);
+
+    stringstream name;
+    name << setw(6) << setfill('0') << i << ".png";
+    vector<int> params;
+    params.push_back(CV_IMWRITE_PNG_COMPRESSION);
+    params.push_back(1);
+    imwrite(job->directory + name.str(), page, params);
+
+    stringstream ss;
+    ss << name.str() << " ";
+    for (int j = 0; j < 81; j++)
+        ss << data[j];
+    ss << " ";
+    for (int j = 0; j < 81; j++)
+        ss << result[j];
+    ss << fixed << setprecision(1);
+    for (int j = 0; j < 4; j++)
+        ss << " " << corners[j].x << " " << corners[j].y;
+    job->truth[i] = ss.str();
+}
+
+//render count puzzle images with ground truth into directory:
+//truth.txt holds "<file> <givens> <solution> <4 outer corners>" per image.
+void synthesize(string directory, int count, int seed, int threads)
+{
+    mkdir(directory.c_str(), 0755);
+
+    SynthJob job;
+    job.directory = directory;
+    job.seed = (uint64)seed;
+    job.truth.resize(count);
+
+    int64 start = getTickCount();
+    run_parallel(count, threads, synth_task, &job);
+    double seconds = (double)(getTickCount() - start) / getTickFrequency();
+
+    string truth_filename = directory + "truth.txt";
+    ofstream fout(truth_filename.c_str());
+    fout << "# file givens solution x0 y0 x1 y1 x2 y2 x3 y3 (outer corners clockwise from top left)" << endl;
+    for (int i = 0; i < count; i++)
+        fout << job.truth[i] << endl;
+
+    cout << count << " images generated in " << seconds << "s ("
+         << (double)count / seconds << " images/s), ground truth is " << truth_filename << endl;
+}
@@ -0,0 +1,205 @@
+/*
+* This file is part of SudokuEz
+*
+* Copyright (C) 2012-2017 Zhong Xu
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*/
+
+//#define SUDOKU_DEBUG
+
+#include <iostream>
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/video/tracking.hpp>
+#include "tracker.h"
+
+using namespace std;
+using namespace cv;
+
+const int TRACK_WINDOW = 15;
+const int TRACK_LEVELS = 2;
+const double MAX_TRACK_ERROR = .15;
+const double MIN_TRACK_CONFIDENCE = .7;
+
+
+//lattice position of corner i, which lies half a cell away from the centers
+Point2f corner_pos(int i)
+{
+    return Point2f((float)(i % 10) - .5f, (float)(i / 10) - .5f);
+}
+
+GridTracker::GridTracker()
+{
+    locked = false;
+    generation = 0;
+    confidence = 0.0;
+}
+
+//least squares fit of the lattice model from lattice positions to image points.
+void GridTracker::fit(vector<Point2f>& lattice, vector<Point2f>& points)
+{
+    Mat m((int)lattice.size(), 3, CV_64FC1), s((int)points.size(), 2, CV_64FC1);
+    for (int row = 0; row < (int)lattice.size(); row++)
+    {
+        m.at<double>(row, 0) = lattice[row].x;
+        m.at<double>(row, 1) = lattice[row].y;
+        m.at<double>(row, 2) = 1.0;
+        s.at<double>(row, 0) = points[row].x;
+        s.at<double>(row, 1) = points[row].y;
+    }
+    model = (m.t() * m).inv() * m.t() * s;
+}
+
+Point2f GridTracker::project(Point2f pos)
+{
+    double x = pos.x * model.at<double>(0, 0) + pos.y * model.at<double>(1, 0) + model.at<double>(2, 0);
+    double y = pos.x * model.at<double>(0, 1) + pos.y * model.at<double>(1, 1) + model.at<double>(2, 1);
+    return Point2f((float)x, (float)y);
+}
+
+//place cells on the lattice model the same way get_cropped_imgs() does.
+bool GridTracker::get_cells(Size size, Rect rects[])
+{
+    Point2f ux = project(Point2f(1, 0)) - project(Point2f(0, 0));
+    Point2f uy = project(Point2f(0, 1)) - project(Point2f(0, 0));
+    double length = (norm(ux) + norm(uy)) / 2;
+
+    int r = (int)(length / 2);
+    for (int y = 0; y < 9; y++)
+    {
+        for (int x = 0; x < 9; x++)
+        {
+            Point fp = project(Point2f((float)x, (float)y));
+            if (fp.x - r < 0 || fp.y - r < 0 || fp.x + r > size.width || fp.y + r > size.height)
+                return false;
+
+            rects[y * 9 + x] = Rect(fp.x - r, fp.y - r, 2 * r, 2 * r);
+        }
+    }
+    return true;
+}
+
+void GridTracker::lock(Mat gray, Rect rects[])
+{
+    vector<Point2f> lattice, centers;
+    for (int i = 0; i < 81; i++)
+    {
+        lattice.push_back(Point2f((float)(i % 9), (float)(i / 9)));
+        centers.push_back(Point2f((float)rects[i].x + (float)rects[i].width / 2,
+                                  (float)rects[i].y + (float)rects[i].height / 2));
+    }
+    fit(lattice, centers);
+
+    corners.clear();
+    for (int i = 0; i < 100; i++)
+        corners.push_back(project(corner_pos(i)));
+
+    gray.copyTo(prev_gray);
+    locked = true;
+    generation += 1;
+    confidence = 1.0;
+}
+
+void GridTracker::rescale(Size size)
+{
+    if (prev_gray.empty() || size == prev_gray.size())
+        return;
+    double fx = (double)size.width / prev_gray.cols, fy = (double)size.height / prev_gray.rows;
+    for (int row = 0; row < 3; row++)
+    {
+        model.at<double>(row, 0) *= fx;
+        model.at<double>(row, 1) *= fy;
+    }
+    for (size_t i = 0; i < corners.size(); i++)
+        corners[i] = Point2f((float)(corners[i].x * fx), (float)(corners[i].y * fy));
+    Mat gray;
+    resize(prev_gray, gray, size);
+    prev_gray = gray;
+}
+
+bool GridTracker::track(Mat gray, Rect rects[])
+{
+    if (!locked)
+        return false;
+
+    //search every corner in a small window around its last position
+    vector<Point2f> next_corners;
+    vector<uchar> status;
+    vector<float> err;
+    calcOpticalFlowPyrLK(prev_gray, gray, corners, next_corners, status, err,
+                         Size(TRACK_WINDOW, TRACK_WINDOW), TRACK_LEVELS);
+
+    vector<Point2f> lattice, points;
+    vector<int> ids;
+    for (int i = 0; i < (int)corners.size(); i++)
+    {
+        if (status[i] == 0)
+            continue;
+        ids.push_back(i);
+        lattice.push_back(corner_pos(i));
+        points.push_back(next_corners[i]);
+    }
+    if (lattice.size() < 3)
+    {
+        locked = false;
+        return false;
+    }
+    fit(lattice, points);
+
+    //reject corners that moved away from the lattice, then fit again
+    Point2f ux = project(Point2f(1, 0)) - project(Point2f(0, 0));
+    double length = norm(ux);
+    vector<Point2f> inlier_lattice, inliers;
+    vector<int> inlier_ids;
+    for (int i = 0; i < (int)lattice.size(); i++)
+    {
+        if (norm(project(lattice[i]) - points[i]) < length * MAX_TRACK_ERROR)
+        {
+            inlier_ids.push_back(ids[i]);
+            inlier_lattice.push_back(lattice[i]);
+            inliers.push_back(points[i]);
+        }
+    }
+    confidence = (double)inliers.size() / (double)corners.size();
+#ifdef SUDOKU_DEBUG
+    cout << "tracking confidence = " << confidence << endl;
+#endif
+    if (confidence < MIN_TRACK_CONFIDENCE)
+    {
+        locked = false;
+        return false;
+    }
+    fit(inlier_lattice, inliers);
+
+    //lost corners are put back on the lattice
+    for (int i = 0; i < (int)corners.size(); i++)
+        corners[i] = project(corner_pos(i));
+    for (int i = 0; i < (int)inliers.size(); i++)
+        corners[inlier_ids[i]] = inliers[i];
+    gray.copyTo(prev_gray);
+
+    if (!get_cells(gray.size(), rects))
+    {
+        locked = false;
+        return false;
+    }
+    return true;
+}
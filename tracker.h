@@ -0,0 +1,77 @@
+/*
+* This file is part of SudokuEz
+*
+* Copyright (C) 2012-2017 Zhong Xu
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*/
+
+#ifndef TRACKER_H
+#define TRACKER_H
+
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+
+using namespace std;
+using namespace cv;
+
+//follows a located grid across frames so that the full detection in
+//get_cropped_imgs() is only needed when the grid is lost.
+class GridTracker
+{
+    public:
+
+    GridTracker();
+
+    //start tracking from the cells found by get_cropped_imgs() in gray.
+    void lock(Mat gray, Rect rects[]);
+    void unlock() {locked = false;}
+    //follow the grid in frames of another size from now on.
+    void rescale(Size size);
+
+    //locate the locked grid in the next frame. returns false if the grid is lost.
+    bool track(Mat gray, Rect rects[]);
+
+    bool is_locked() {return locked;}
+    //number of lock() calls, which tells a grid from the ones locked before
+    long get_generation() {return generation;}
+    double get_confidence() {return confidence;}
+
+    private:
+
+    void fit(vector<Point2f>& lattice, vector<Point2f>& points);
+    Point2f project(Point2f pos);
+    bool get_cells(Size size, Rect rects[]);
+
+    //the grid is modelled as an affine lattice: [x y 1] * model is the
+    //center of cell (x, y), the same model get_cof_mat() fits.
+    Mat model;
+    //the 10x10 corners of the cells, which are followed by optical flow.
+    vector<Point2f> corners;
+    Mat prev_gray;
+
+    bool locked;
+    long generation;
+    double confidence;
+};
+
+#endif